@@ -81,9 +81,17 @@
       "src/llnode.cc",
       "src/llv8.cc",
       "src/llv8-constants.cc",
+      "src/memory-cache.cc",
+      "src/core-reader.cc",
+      "src/object-table.cc",
+      "src/scan-index.cc",
+      "src/heap-graph.cc",
+      "src/string-index.cc",
+      "src/utf.cc",
       "src/llscan.cc",
       "src/error.cc",
       "src/constants.cc",
+      "src/layout-profile.cc",
       "src/node-constants"
     ],
     'cflags!': [ '-fno-exceptions' ],
@@ -131,9 +139,17 @@
           "src/llnode_module.cc",
           "src/llnode_api.cc",
           "src/constants.cc",
+          "src/layout-profile.cc",
           "src/error.cc",
           "src/llv8.cc",
           "src/llv8-constants.cc",
+          "src/memory-cache.cc",
+          "src/core-reader.cc",
+          "src/object-table.cc",
+          "src/scan-index.cc",
+          "src/heap-graph.cc",
+          "src/string-index.cc",
+          "src/utf.cc",
           "src/llscan.cc",
           "src/node-constants.cc",
         ],
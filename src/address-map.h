@@ -0,0 +1,94 @@
+#ifndef SRC_ADDRESS_MAP_H_
+#define SRC_ADDRESS_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace llnode {
+
+/* Hash map from non-zero addresses to small values, using open addressing
+ * with linear probing over a single flat array. Lookups don't allocate and
+ * touch one or two cache lines, which matters on the per-object paths of
+ * heap scans. Key 0 marks empty slots and can't be stored.
+ */
+template <class T>
+class AddressMap {
+ public:
+  AddressMap() : size_(0), shift_(64) {}
+
+  inline size_t size() const { return size_; }
+
+  inline void Clear() {
+    slots_.clear();
+    size_ = 0;
+    shift_ = 64;
+  }
+
+  /* Returns the value stored for `key`, or nullptr. The pointer is valid
+   * until the next insertion.
+   */
+  inline T* Find(uint64_t key) {
+    if (slots_.empty()) return nullptr;
+
+    for (size_t i = Hash(key);; i = (i + 1) & (slots_.size() - 1)) {
+      Slot& slot = slots_[i];
+      if (slot.key == key) return &slot.value;
+      if (slot.key == 0) return nullptr;
+    }
+  }
+
+  /* Store `value` for `key`, replacing any previous value. */
+  inline void Insert(uint64_t key, const T& value) {
+    // Keep the table at most half full so probe sequences stay short
+    if ((size_ + 1) * 2 > slots_.size()) Grow();
+
+    for (size_t i = Hash(key);; i = (i + 1) & (slots_.size() - 1)) {
+      Slot& slot = slots_[i];
+      if (slot.key == key) {
+        slot.value = value;
+        return;
+      }
+      if (slot.key == 0) {
+        slot.key = key;
+        slot.value = value;
+        size_++;
+        return;
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    uint64_t key;
+    T value;
+  };
+
+  inline size_t Hash(uint64_t key) const {
+    // Fibonacci hashing, the top bits mix in every bit of the address
+    return static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> shift_);
+  }
+
+  void Grow() {
+    std::vector<Slot> old;
+    old.swap(slots_);
+
+    size_t capacity = old.empty() ? 64 : old.size() * 2;
+    slots_.resize(capacity, Slot{0, T()});
+    shift_ = 64;
+    for (size_t c = capacity; c > 1; c >>= 1) shift_--;
+    size_ = 0;
+
+    for (const Slot& slot : old) {
+      if (slot.key != 0) Insert(slot.key, slot.value);
+    }
+  }
+
+  std::vector<Slot> slots_;
+  size_t size_;
+  uint32_t shift_;
+};
+
+}  // namespace llnode
+
+#endif  // SRC_ADDRESS_MAP_H_
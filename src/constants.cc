@@ -1,11 +1,14 @@
 #include <cinttypes>
+#include <cstring>
 
 #include <lldb/API/SBExpressionOptions.h>
 
 #include "src/constants.h"
+#include "src/layout-profile.h"
 
 using lldb::SBAddress;
 using lldb::SBError;
+using lldb::SBModule;
 using lldb::SBSymbol;
 using lldb::SBSymbolContext;
 using lldb::SBSymbolContextList;
@@ -26,28 +29,73 @@ T ReadSymbolFromTarget(SBTarget& target, SBAddress& start, const char* name,
   return res;
 }
 
-int64_t Constants::LookupConstant(SBTarget target, const char* name,
-                                  int64_t def, Error& err) {
-  int64_t res = 0;
-  res = def;
+static const char* const kIndexedPrefixes[] = {"v8dbg_", "nodedbg_"};
 
-  SBSymbolContextList context_list = target.FindSymbols(name);
 
-  if (!context_list.IsValid() || context_list.GetSize() == 0) {
-    err = Error::Failure("Failed to find symbol %s", name);
-    return res;
+static uint32_t SymbolSize(SBSymbol& symbol) {
+  return symbol.GetEndAddress().GetOffset() -
+         symbol.GetStartAddress().GetOffset();
+}
+
+
+const ConstantsIndex& ConstantsIndex::Get(SBTarget target) {
+  static SBTarget indexed_target;
+  static uint32_t indexed_modules = 0;
+  static ConstantsIndex index;
+
+  // Modules loaded since, like a shared libnode or the modules of a process
+  // started after the first lookup, may hold the constants
+  uint32_t num_modules = target.GetNumModules();
+  if (!indexed_target.IsValid() || indexed_target != target ||
+      indexed_modules != num_modules) {
+    index.Build(target);
+    indexed_target = target;
+    indexed_modules = num_modules;
   }
+  return index;
+}
 
-  SBSymbolContext context = context_list.GetContextAtIndex(0);
-  SBSymbol symbol = context.GetSymbol();
-  if (!symbol.IsValid()) {
-    err = Error::Failure("Failed to fetch symbol %s from context", name);
-    return res;
+
+bool ConstantsIndex::IsIndexed(const char* name) {
+  for (const char* prefix : kIndexedPrefixes)
+    if (strncmp(name, prefix, strlen(prefix)) == 0) return true;
+  return false;
+}
+
+
+void ConstantsIndex::Build(SBTarget target) {
+  symbols_.clear();
+
+  // Modules are in load order, the main executable comes first and wins if
+  // a constant is defined twice, like it did with FindSymbols()
+  uint32_t num_modules = target.GetNumModules();
+  for (uint32_t i = 0; i < num_modules; i++) {
+    SBModule module = target.GetModuleAtIndex(i);
+    size_t num_symbols = module.GetNumSymbols();
+    for (size_t j = 0; j < num_symbols; j++) {
+      SBSymbol symbol = module.GetSymbolAtIndex(j);
+      const char* name = symbol.GetName();
+      if (name == nullptr || !IsIndexed(name)) continue;
+
+      Symbol entry = {symbol.GetStartAddress(), SymbolSize(symbol)};
+      symbols_.emplace(name, entry);
+    }
   }
 
-  SBAddress start = symbol.GetStartAddress();
-  SBAddress end = symbol.GetEndAddress();
-  uint32_t size = end.GetOffset() - start.GetOffset();
+  Error::PrintInDebugMode("Indexed %zu postmortem constants", symbols_.size());
+}
+
+
+const ConstantsIndex::Symbol* ConstantsIndex::Find(const char* name) const {
+  auto it = symbols_.find(name);
+  if (it == symbols_.end()) return nullptr;
+  return &it->second;
+}
+
+
+static int64_t ReadConstant(SBTarget& target, SBAddress start, uint32_t size,
+                            const char* name, int64_t def, Error& err) {
+  int64_t res = def;
 
   // NOTE: size could be bigger for at the end symbols
   if (size >= 8) {
@@ -69,6 +117,72 @@ int64_t Constants::LookupConstant(SBTarget target, const char* name,
   return res;
 }
 
+
+// Sets `missing` if the target has no symbol for the constant
+static int64_t LookupSymbol(SBTarget target, const char* name, int64_t def,
+                            bool& missing, Error& err) {
+  missing = false;
+  if (ConstantsIndex::IsIndexed(name)) {
+    const ConstantsIndex& index = ConstantsIndex::Get(target);
+    const ConstantsIndex::Symbol* symbol = index.Find(name);
+    if (symbol == nullptr) {
+      missing = true;
+      err = Error::Failure("Failed to find symbol %s", name);
+      return def;
+    }
+    return ReadConstant(target, symbol->start, symbol->size, name, def, err);
+  }
+
+  SBSymbolContextList context_list = target.FindSymbols(name);
+
+  if (!context_list.IsValid() || context_list.GetSize() == 0) {
+    missing = true;
+    err = Error::Failure("Failed to find symbol %s", name);
+    return def;
+  }
+
+  SBSymbolContext context = context_list.GetContextAtIndex(0);
+  SBSymbol symbol = context.GetSymbol();
+  if (!symbol.IsValid()) {
+    err = Error::Failure("Failed to fetch symbol %s from context", name);
+    return def;
+  }
+
+  return ReadConstant(target, symbol.GetStartAddress(), SymbolSize(symbol),
+                      name, def, err);
+}
+
+
+/* Constants already in the layout profile of the target are served from
+ * it, the others are looked up in the symbols and added to it.
+ */
+int64_t Constants::LookupConstant(SBTarget target, const char* name,
+                                  int64_t def, Error& err) {
+  LayoutProfile& profile = LayoutProfile::Get(target);
+  int64_t value = def;
+  switch (profile.Find(name, value)) {
+    case LayoutProfile::kFound:
+      err = Error::Ok();
+      return value;
+    case LayoutProfile::kMissing:
+      err = Error::Failure("Failed to find symbol %s", name);
+      return def;
+    case LayoutProfile::kUnknown:
+      break;
+  }
+
+  // A binary without any postmortem symbol is likely stripped, its misses
+  // would hide the constants of the unstripped build with the same build-id
+  bool missing;
+  value = LookupSymbol(target, name, def, missing, err);
+  if (err.Success())
+    profile.Record(name, true, value);
+  else if (missing && ConstantsIndex::Get(target).size() != 0)
+    profile.Record(name, false, def);
+  return value;
+}
+
+
 void Constants::Assign(SBTarget target) {
   loaded_ = false;
   target_ = target;
@@ -3,6 +3,7 @@
 
 #include <lldb/API/LLDB.h>
 #include <string>
+#include <unordered_map>
 
 #include "src/error.h"
 
@@ -18,6 +19,34 @@ namespace llnode {
     return this;                        \
   }
 
+/* Postmortem constants of a target, the symbols named v8dbg_* and
+ * nodedbg_*. The symbol tables of all modules are walked when the first
+ * constant is looked up, and again once modules were loaded, instead of
+ * being searched for every constant.
+ */
+class ConstantsIndex {
+ public:
+  struct Symbol {
+    lldb::SBAddress start;
+    uint32_t size;
+  };
+
+  // Index of `target`, kept until a different target is looked up or the
+  // number of modules of the target changes
+  static const ConstantsIndex& Get(SBTarget target);
+
+  // True if `name` is a postmortem constant, which is only looked up here
+  static bool IsIndexed(const char* name);
+
+  const Symbol* Find(const char* name) const;
+  inline size_t size() const { return symbols_.size(); }
+
+ private:
+  void Build(SBTarget target);
+
+  std::unordered_map<std::string, Symbol> symbols_;
+};
+
 class Constants {
  public:
   Constants() : loaded_(false) {}
@@ -0,0 +1,274 @@
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include <algorithm>
+
+#include "src/core-reader.h"
+
+namespace llnode {
+
+// ELF definitions, see elf(5)
+static const uint8_t kELFMagic[] = {0x7f, 'E', 'L', 'F'};
+static const uint8_t kELFClass32 = 1;
+static const uint8_t kELFClass64 = 2;
+static const uint8_t kELFDataBigEndian = 2;
+static const uint16_t kELFTypeCore = 4;
+static const uint16_t kELFExtendedNumbering = 0xffff;
+static const uint32_t kPTLoad = 1;
+static const uint32_t kPFWrite = 2;
+
+// Mach-O definitions, see <mach-o/loader.h>
+static const uint32_t kMachOMagic32 = 0xfeedface;
+static const uint32_t kMachOMagic64 = 0xfeedfacf;
+static const uint32_t kMachOTypeCore = 4;
+static const uint32_t kLCSegment = 0x1;
+static const uint32_t kLCSegment64 = 0x19;
+static const uint32_t kVMProtWrite = 2;
+
+
+bool CoreMemoryReader::Open(const char* path, Error& err) {
+  Close();
+
+#ifdef _WIN32
+  err = Error::Failure("Mapping core files is not supported on this platform");
+  return false;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    err = Error::Failure("Failed to open core file '%s'", path);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    err = Error::Failure("Failed to stat core file '%s'", path);
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file
+  close(fd);
+  if (data == MAP_FAILED) {
+    err = Error::Failure("Failed to map core file '%s'", path);
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = static_cast<uint64_t>(st.st_size);
+  path_ = path;
+
+  bool parsed;
+  if (size_ >= sizeof(kELFMagic) &&
+      memcmp(data_, kELFMagic, sizeof(kELFMagic)) == 0) {
+    parsed = ParseELF(err);
+  } else {
+    parsed = ParseMachO(err);
+  }
+
+  if (!parsed) {
+    Close();
+    return false;
+  }
+
+  err = Error::Ok();
+  return true;
+#endif  // _WIN32
+}
+
+
+void CoreMemoryReader::Close() {
+#ifndef _WIN32
+  if (data_ != nullptr)
+    munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+#endif  // _WIN32
+  data_ = nullptr;
+  size_ = 0;
+  address_byte_size_ = 0;
+  big_endian_ = false;
+  path_.clear();
+  segments_.clear();
+}
+
+
+uint64_t CoreMemoryReader::ReadField(uint64_t offset, uint32_t size) const {
+  if (offset + size > size_) return 0;
+
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    uint32_t index = big_endian_ ? i : size - i - 1;
+    value = (value << 8) | data_[offset + index];
+  }
+  return value;
+}
+
+
+bool CoreMemoryReader::ParseELF(Error& err) {
+  if (size_ < 64) {
+    err = Error::Failure("'%s' is not an ELF file", path_.c_str());
+    return false;
+  }
+
+  bool is_64 = data_[4] == kELFClass64;
+  if (!is_64 && data_[4] != kELFClass32) {
+    err = Error::Failure("Unknown ELF class %d", data_[4]);
+    return false;
+  }
+  address_byte_size_ = is_64 ? 8 : 4;
+  big_endian_ = data_[5] == kELFDataBigEndian;
+
+  if (ReadField(16, 2) != kELFTypeCore) {
+    err = Error::Failure("'%s' is not a core file", path_.c_str());
+    return false;
+  }
+
+  uint64_t phoff = ReadField(is_64 ? 32 : 28, address_byte_size_);
+  uint64_t phentsize = ReadField(is_64 ? 54 : 42, 2);
+  uint64_t phnum = ReadField(is_64 ? 56 : 44, 2);
+
+  // With more than 0xfffe segments the real count lives in the sh_info field
+  // of the first section header.
+  if (phnum == kELFExtendedNumbering) {
+    uint64_t shoff = ReadField(is_64 ? 40 : 32, address_byte_size_);
+    phnum = ReadField(shoff + (is_64 ? 44 : 28), 4);
+  }
+
+  if (phentsize == 0 || phoff + phnum * phentsize > size_) {
+    err = Error::Failure("Invalid program headers in '%s'", path_.c_str());
+    return false;
+  }
+
+  for (uint64_t i = 0; i < phnum; i++) {
+    uint64_t ph = phoff + i * phentsize;
+    if (ReadField(ph, 4) != kPTLoad) continue;
+
+    uint64_t offset, vaddr, filesz, memsz, flags;
+    if (is_64) {
+      flags = ReadField(ph + 4, 4);
+      offset = ReadField(ph + 8, 8);
+      vaddr = ReadField(ph + 16, 8);
+      filesz = ReadField(ph + 32, 8);
+      memsz = ReadField(ph + 40, 8);
+    } else {
+      offset = ReadField(ph + 4, 4);
+      vaddr = ReadField(ph + 8, 4);
+      filesz = ReadField(ph + 16, 4);
+      memsz = ReadField(ph + 20, 4);
+      flags = ReadField(ph + 24, 4);
+    }
+
+    AddSegment(vaddr, memsz, offset, filesz, (flags & kPFWrite) != 0);
+  }
+
+  FinishSegments();
+  return true;
+}
+
+
+bool CoreMemoryReader::ParseMachO(Error& err) {
+  // The magic tells both the word size and the byte order
+  if (size_ < 32) {
+    err = Error::Failure("'%s' is not a core file", path_.c_str());
+    return false;
+  }
+  uint64_t magic = ReadField(0, 4);
+  if (magic != kMachOMagic32 && magic != kMachOMagic64) {
+    big_endian_ = true;
+    magic = ReadField(0, 4);
+  }
+  if (magic != kMachOMagic32 && magic != kMachOMagic64) {
+    err = Error::Failure("'%s' is neither an ELF nor a Mach-O file",
+                         path_.c_str());
+    return false;
+  }
+
+  bool is_64 = magic == kMachOMagic64;
+  address_byte_size_ = is_64 ? 8 : 4;
+
+  if (ReadField(12, 4) != kMachOTypeCore) {
+    err = Error::Failure("'%s' is not a core file", path_.c_str());
+    return false;
+  }
+
+  uint64_t ncmds = ReadField(16, 4);
+  uint64_t cmd = is_64 ? 32 : 28;
+  for (uint64_t i = 0; i < ncmds; i++) {
+    uint64_t type = ReadField(cmd, 4);
+    uint64_t cmdsize = ReadField(cmd + 4, 4);
+    if (cmdsize == 0 || cmd + cmdsize > size_) {
+      err = Error::Failure("Invalid load commands in '%s'", path_.c_str());
+      return false;
+    }
+
+    // Both segment commands start with a 16 byte name after cmd and cmdsize
+    if (type == kLCSegment64) {
+      AddSegment(ReadField(cmd + 24, 8), ReadField(cmd + 32, 8),
+                 ReadField(cmd + 40, 8), ReadField(cmd + 48, 8),
+                 (ReadField(cmd + 60, 4) & kVMProtWrite) != 0);
+    } else if (type == kLCSegment) {
+      AddSegment(ReadField(cmd + 24, 4), ReadField(cmd + 28, 4),
+                 ReadField(cmd + 32, 4), ReadField(cmd + 36, 4),
+                 (ReadField(cmd + 44, 4) & kVMProtWrite) != 0);
+    }
+
+    cmd += cmdsize;
+  }
+
+  FinishSegments();
+  return true;
+}
+
+
+void CoreMemoryReader::AddSegment(uint64_t vaddr, uint64_t memsz,
+                                  uint64_t offset, uint64_t filesz,
+                                  bool writable) {
+  if (memsz == 0) return;
+
+  // Cores are often truncated by ulimit, only trust what is in the file
+  bool truncated = false;
+  if (filesz > memsz) filesz = memsz;
+  if (offset >= size_) {
+    truncated = filesz > 0;
+    filesz = 0;
+  } else if (filesz > size_ - offset) {
+    filesz = size_ - offset;
+    truncated = true;
+  }
+
+  segments_.emplace_back(vaddr, memsz, offset, filesz, writable, truncated);
+}
+
+
+void CoreMemoryReader::FinishSegments() {
+  std::sort(segments_.begin(), segments_.end(),
+            [](const Segment& a, const Segment& b) {
+              return a.vaddr_ < b.vaddr_;
+            });
+
+  Error::PrintInDebugMode("Mapped core '%s', %zu load segments", path_.c_str(),
+                          segments_.size());
+}
+
+
+const uint8_t* CoreMemoryReader::GetPointer(uint64_t addr, size_t size) const {
+  if (segments_.empty()) return nullptr;
+
+  // Find the last segment starting at or before `addr`
+  auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), addr,
+      [](uint64_t a, const Segment& segment) { return a < segment.vaddr_; });
+  if (it == segments_.begin()) return nullptr;
+  --it;
+
+  uint64_t delta = addr - it->vaddr_;
+  if (delta >= it->filesz_ || size > it->filesz_ - delta) return nullptr;
+
+  return data_ + it->offset_ + delta;
+}
+
+}  // namespace llnode
@@ -0,0 +1,97 @@
+#ifndef SRC_CORE_READER_H_
+#define SRC_CORE_READER_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "src/error.h"
+
+namespace llnode {
+
+/* Direct, zero-copy access to the memory stored in a core file.
+ *
+ * The core is mapped into our address space and its segments (ELF PT_LOAD
+ * program headers or Mach-O LC_SEGMENT commands) are kept in a table sorted
+ * by virtual address, so a lookup is a binary search followed by pointer
+ * arithmetic. Addresses the core doesn't contain
+ * (e.g. segments dropped or truncated by the kernel) are reported as not
+ * covered and callers are expected to fall back to SBProcess for them.
+ */
+class CoreMemoryReader {
+ public:
+  class Segment {
+   public:
+    Segment(uint64_t vaddr, uint64_t memsz, uint64_t offset, uint64_t filesz,
+            bool writable, bool truncated)
+        : vaddr_(vaddr),
+          memsz_(memsz),
+          offset_(offset),
+          filesz_(filesz),
+          writable_(writable),
+          truncated_(truncated) {}
+
+    inline uint64_t start() const { return vaddr_; }
+    inline uint64_t end() const { return vaddr_ + memsz_; }
+    // Bytes of the segment actually present in the file
+    inline uint64_t available() const { return filesz_; }
+    inline bool IsWritable() const { return writable_; }
+    // The file ends before the data the segment header describes
+    inline bool IsTruncated() const { return truncated_; }
+
+    uint64_t vaddr_;
+    uint64_t memsz_;
+    uint64_t offset_;
+    uint64_t filesz_;
+    bool writable_;
+    bool truncated_;
+  };
+
+  CoreMemoryReader() {}
+  ~CoreMemoryReader() { Close(); }
+
+  bool Open(const char* path, Error& err);
+  void Close();
+
+  inline bool IsOpen() const { return data_ != nullptr; }
+  inline const std::string& path() const { return path_; }
+  inline uint32_t address_byte_size() const { return address_byte_size_; }
+  inline bool big_endian() const { return big_endian_; }
+  inline const std::vector<Segment>& segments() const { return segments_; }
+
+  /* Return a pointer to `size` bytes of process memory at `addr`, or nullptr
+   * if the core doesn't contain the whole range in a single segment.
+   */
+  const uint8_t* GetPointer(uint64_t addr, size_t size) const;
+
+  inline bool Read(uint64_t addr, void* buf, size_t size) const {
+    const uint8_t* ptr = GetPointer(addr, size);
+    if (ptr == nullptr) return false;
+    memcpy(buf, ptr, size);
+    return true;
+  }
+
+ private:
+  CoreMemoryReader(const CoreMemoryReader&) = delete;
+  CoreMemoryReader& operator=(const CoreMemoryReader&) = delete;
+
+  bool ParseELF(Error& err);
+  bool ParseMachO(Error& err);
+  void AddSegment(uint64_t vaddr, uint64_t memsz, uint64_t offset,
+                  uint64_t filesz, bool writable);
+  void FinishSegments();
+  uint64_t ReadField(uint64_t offset, uint32_t size) const;
+
+  std::string path_;
+  const uint8_t* data_ = nullptr;
+  uint64_t size_ = 0;
+  uint32_t address_byte_size_ = 0;
+  bool big_endian_ = false;
+  std::vector<Segment> segments_;
+};
+
+}  // namespace llnode
+
+#endif  // SRC_CORE_READER_H_
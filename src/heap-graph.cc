@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <iterator>
+
+#include "src/address-map.h"
+#include "src/heap-graph.h"
+
+namespace llnode {
+
+void ReferenceIndex::Build() {
+  std::sort(edges_.begin(), edges_.end(), [](const Edge& a, const Edge& b) {
+    return a.target < b.target || (a.target == b.target && a.source < b.source);
+  });
+
+  // First pass: size the arrays, an object referencing a value several
+  // times is only recorded once.
+  size_t target_count = 0;
+  size_t source_count = 0;
+  for (size_t i = 0; i < edges_.size(); i++) {
+    if (i > 0 && edges_[i].target == edges_[i - 1].target) {
+      if (edges_[i].source != edges_[i - 1].source) source_count++;
+      continue;
+    }
+    target_count++;
+    source_count++;
+  }
+
+  targets_.clear();
+  offsets_.clear();
+  sources_.clear();
+  targets_.reserve(target_count);
+  offsets_.reserve(target_count + 1);
+  sources_.reserve(source_count);
+
+  // Second pass: fill them in
+  for (size_t i = 0; i < edges_.size(); i++) {
+    const Edge& edge = edges_[i];
+    if (i == 0 || edge.target != edges_[i - 1].target) {
+      targets_.push_back(edge.target);
+      offsets_.push_back(sources_.size());
+    } else if (edge.source == edges_[i - 1].source) {
+      continue;
+    }
+    sources_.push_back(edge.source);
+  }
+  offsets_.push_back(sources_.size());
+
+  edges_.clear();
+  edges_.shrink_to_fit();
+  built_ = true;
+}
+
+
+void ReferenceIndex::Clear() {
+  built_ = false;
+  edges_.clear();
+  targets_.clear();
+  offsets_.clear();
+  sources_.clear();
+}
+
+
+void ReferenceIndex::Save(ScanIndexWriter& writer) const {
+  writer.WriteArray(targets_);
+  writer.WriteArray(offsets_);
+  writer.WriteArray(sources_);
+}
+
+
+bool ReferenceIndex::Load(ScanIndexReader& reader) {
+  Clear();
+
+  reader.ReadArray(targets_);
+  reader.ReadArray(offsets_);
+  reader.ReadArray(sources_);
+
+  bool valid = !reader.failed() && offsets_.size() == targets_.size() + 1 &&
+               offsets_[0] == 0 && offsets_.back() == sources_.size();
+  for (size_t i = 1; valid && i < offsets_.size(); i++)
+    valid = offsets_[i - 1] <= offsets_[i];
+  if (!valid) {
+    Clear();
+    return false;
+  }
+
+  built_ = true;
+  return true;
+}
+
+
+int64_t ReferenceIndex::FindTarget(uint64_t target) const {
+  auto it = std::lower_bound(targets_.begin(), targets_.end(), target);
+  if (it == targets_.end() || *it != target) return -1;
+  return it - targets_.begin();
+}
+
+
+void FindRetainerPaths(const ReferenceIndex& index, uint64_t object,
+                       const RootPredicate& is_root, uint32_t max_depth,
+                       uint32_t max_paths, std::vector<RetainerPath>& paths) {
+  paths.clear();
+  if (object == 0 || max_paths == 0) return;
+
+  // Every object reached maps to the object it references, one step closer
+  // to `object`
+  AddressMap<uint64_t> next;
+  next.Insert(object, object);
+
+  std::vector<uint64_t> frontier(1, object);
+  std::vector<uint64_t> reached;
+  for (uint32_t depth = 0; !frontier.empty(); depth++) {
+    reached.clear();
+
+    for (uint64_t current : frontier) {
+      std::string reason;
+      ReferenceRange referrers = index.GetReferences(current);
+      bool end = is_root(current, reason);
+      if (!end && referrers.empty()) {
+        reason = "no referrers found";
+        end = true;
+      }
+
+      if (end) {
+        RetainerPath path;
+        path.root = reason;
+        for (uint64_t o = current;; o = *next.Find(o)) {
+          path.objects.push_back(o);
+          if (o == object) break;
+        }
+        std::reverse(path.objects.begin(), path.objects.end());
+        paths.push_back(path);
+        if (paths.size() >= max_paths) return;
+        continue;
+      }
+
+      if (depth >= max_depth) continue;
+      for (uint64_t referrer : referrers) {
+        if (next.Find(referrer) != nullptr) continue;
+        next.Insert(referrer, current);
+        reached.push_back(referrer);
+      }
+    }
+
+    frontier.swap(reached);
+  }
+}
+
+bool DominatorTree::Build(const ReferenceIndex& index,
+                          const ObjectPredicate& is_object,
+                          const RootPredicate& is_root,
+                          const SizeFunction& size) {
+  Clear();
+  if (index.ReferenceCount() >= UINT32_MAX) return false;
+
+  // Collect the referencing objects, compacting them as they are found
+  // many times
+  std::vector<uint64_t> sources;
+  size_t compact_limit = 1 << 20;
+  for (size_t i = 0; i < index.TargetCount(); i++) {
+    ReferenceRange references = index.GetReferencesAt(i);
+    sources.insert(sources.end(), references.begin(), references.end());
+    if (sources.size() < compact_limit) continue;
+
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+    compact_limit = std::max(compact_limit, sources.size() * 2);
+  }
+  std::sort(sources.begin(), sources.end());
+  sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+  std::vector<uint64_t> targets;
+  for (size_t i = 0; i < index.TargetCount(); i++) {
+    if (is_object(index.GetTarget(i))) targets.push_back(index.GetTarget(i));
+  }
+
+  std::set_union(sources.begin(), sources.end(), targets.begin(),
+                 targets.end(), std::back_inserter(nodes_));
+  sources = std::vector<uint64_t>();
+  targets = std::vector<uint64_t>();
+  if (nodes_.size() >= UINT32_MAX) {
+    Clear();
+    return false;
+  }
+
+  // Referrers of every object, by number. Both lists are sorted, walk them
+  // side by side.
+  uint32_t n = static_cast<uint32_t>(nodes_.size());
+  std::vector<uint32_t> pred_offsets(n + 1);
+  std::vector<uint32_t> preds;
+  preds.reserve(index.ReferenceCount());
+  for (uint32_t v = 0, t = 0; v < n; v++) {
+    pred_offsets[v] = preds.size();
+    while (t < index.TargetCount() && index.GetTarget(t) < nodes_[v]) t++;
+    if (t == index.TargetCount() || index.GetTarget(t) != nodes_[v]) continue;
+    for (uint64_t source : index.GetReferencesAt(t))
+      preds.push_back(static_cast<uint32_t>(Find(source)));
+  }
+  pred_offsets[n] = preds.size();
+
+  // References of every object, for the depth-first search
+  std::vector<uint32_t> succ_offsets(n + 1, 0);
+  for (uint32_t pred : preds) succ_offsets[pred + 1]++;
+  for (uint32_t v = 0; v < n; v++) succ_offsets[v + 1] += succ_offsets[v];
+  std::vector<uint32_t> succs(preds.size());
+  {
+    std::vector<uint32_t> next(succ_offsets.begin(), succ_offsets.end() - 1);
+    for (uint32_t v = 0; v < n; v++) {
+      for (uint32_t i = pred_offsets[v]; i < pred_offsets[v + 1]; i++)
+        succs[next[preds[i]]++] = v;
+    }
+  }
+
+  std::vector<bool> root_child(n, false);
+  for (uint32_t v = 0; v < n; v++) {
+    std::string reason;
+    root_child[v] =
+        pred_offsets[v] == pred_offsets[v + 1] || is_root(nodes_[v], reason);
+  }
+
+  // Depth-first search from the virtual root, numbered 0. `idom` starts as
+  // the parent in the search tree.
+  static const uint32_t kUnvisited = UINT32_MAX;
+  std::vector<uint32_t> pre(n, kUnvisited);
+  std::vector<uint32_t> vertex(1, n);
+  std::vector<uint32_t> idom(1, 0);
+  vertex.reserve(n + 1);
+  idom.reserve(n + 1);
+
+  std::vector<std::pair<uint32_t, uint32_t>> stack;
+  auto search = [&](uint32_t start) {
+    pre[start] = vertex.size();
+    vertex.push_back(start);
+    idom.push_back(0);
+    stack.emplace_back(start, succ_offsets[start]);
+
+    while (!stack.empty()) {
+      uint32_t v = stack.back().first;
+      uint32_t i = stack.back().second;
+      if (i == succ_offsets[v + 1]) {
+        stack.pop_back();
+        continue;
+      }
+      stack.back().second++;
+
+      uint32_t w = succs[i];
+      if (pre[w] != kUnvisited) continue;
+      pre[w] = vertex.size();
+      vertex.push_back(w);
+      idom.push_back(pre[v]);
+      stack.emplace_back(w, succ_offsets[w]);
+    }
+  };
+  for (uint32_t v = 0; v < n; v++) {
+    if (root_child[v] && pre[v] == kUnvisited) search(v);
+  }
+  // What is left is only reachable from cycles nothing else references
+  for (uint32_t v = 0; v < n; v++) {
+    if (pre[v] != kUnvisited) continue;
+    root_child[v] = true;
+    search(v);
+  }
+  succ_offsets = std::vector<uint32_t>();
+  succs = std::vector<uint32_t>();
+  stack = std::vector<std::pair<uint32_t, uint32_t>>();
+
+  // Semi-dominators, in reverse preorder
+  uint32_t m = n + 1;
+  std::vector<uint32_t> semi(m);
+  std::vector<uint32_t> label(m);
+  for (uint32_t w = 0; w < m; w++) semi[w] = label[w] = w;
+  std::vector<uint32_t> ancestor(idom);
+  std::vector<uint32_t> eval_stack;
+  for (uint32_t w = m - 1; w > 0; w--) {
+    uint32_t v = vertex[w];
+    uint32_t s = root_child[v] ? 0 : idom[w];
+    for (uint32_t i = pred_offsets[v]; i < pred_offsets[v + 1]; i++) {
+      uint32_t u = Eval(pre[preds[i]], w + 1, ancestor, label, semi,
+                        eval_stack);
+      s = std::min(s, semi[u]);
+    }
+    semi[w] = s;
+  }
+  preds = std::vector<uint32_t>();
+  pred_offsets = std::vector<uint32_t>();
+  ancestor = std::vector<uint32_t>();
+  label = std::vector<uint32_t>();
+
+  // Immediate dominators, the nearest common ancestor of the parent and the
+  // semi-dominator in preorder
+  for (uint32_t w = 1; w < m; w++) {
+    uint32_t d = idom[w];
+    while (d > semi[w]) d = idom[d];
+    idom[w] = d;
+  }
+  semi = std::vector<uint32_t>();
+
+  // Sizes flow up the tree, children always come after their dominator
+  std::vector<uint64_t> retained(m, 0);
+  for (uint32_t w = 1; w < m; w++) retained[w] = size(nodes_[vertex[w]]);
+  for (uint32_t w = m - 1; w > 0; w--) retained[idom[w]] += retained[w];
+
+  dominators_.resize(n);
+  retained_.resize(n);
+  for (uint32_t v = 0; v < n; v++) {
+    uint32_t w = pre[v];
+    dominators_[v] = idom[w] == 0 ? kNoDominator : vertex[idom[w]];
+    retained_[v] = retained[w];
+  }
+
+  built_ = true;
+  return true;
+}
+
+
+/* Label of the smallest semi-dominator on the path from `v` to the root of
+ * its tree in the forest of already processed objects, compressing the path
+ * on the way.
+ */
+uint32_t DominatorTree::Eval(uint32_t v, uint32_t last_linked,
+                             std::vector<uint32_t>& ancestor,
+                             std::vector<uint32_t>& label,
+                             const std::vector<uint32_t>& semi,
+                             std::vector<uint32_t>& stack) const {
+  if (ancestor[v] < last_linked) return label[v];
+
+  stack.clear();
+  uint32_t x = v;
+  do {
+    stack.push_back(x);
+    x = ancestor[x];
+  } while (ancestor[x] >= last_linked);
+
+  uint32_t p = x;
+  uint32_t p_label = label[p];
+  do {
+    x = stack.back();
+    stack.pop_back();
+    ancestor[x] = ancestor[p];
+    if (semi[p_label] < semi[label[x]])
+      label[x] = p_label;
+    else
+      p_label = label[x];
+    p = x;
+  } while (!stack.empty());
+
+  return label[x];
+}
+
+
+void DominatorTree::Clear() {
+  built_ = false;
+  nodes_.clear();
+  dominators_.clear();
+  retained_.clear();
+}
+
+
+int64_t DominatorTree::Find(uint64_t address) const {
+  auto it = std::lower_bound(nodes_.begin(), nodes_.end(), address);
+  if (it == nodes_.end() || *it != address) return -1;
+  return it - nodes_.begin();
+}
+
+
+void DominatorTree::GetDominated(uint32_t node,
+                                 std::vector<uint32_t>& dominated) const {
+  dominated.clear();
+  for (uint32_t v = 0; v < dominators_.size(); v++) {
+    if (dominators_[v] == node) dominated.push_back(v);
+  }
+}
+
+
+void DominatorTree::GetGroupRetainedSizes(const GroupFunction& group,
+                                          uint32_t group_count,
+                                          std::vector<uint64_t>& sizes) const {
+  sizes.assign(group_count, 0);
+
+  // Children of every object in the tree, the last list is the virtual
+  // root's
+  uint32_t n = static_cast<uint32_t>(nodes_.size());
+  std::vector<uint32_t> offsets(n + 2, 0);
+  for (uint32_t d : dominators_) offsets[(d == kNoDominator ? n : d) + 1]++;
+  for (uint32_t v = 0; v <= n; v++) offsets[v + 1] += offsets[v];
+  std::vector<uint32_t> children(n);
+  {
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (uint32_t v = 0; v < n; v++) {
+      uint32_t d = dominators_[v] == kNoDominator ? n : dominators_[v];
+      children[next[d]++] = v;
+    }
+  }
+
+  // Walk the tree, counting how many objects of each group are open on
+  // the current path
+  struct Frame {
+    uint32_t node;
+    uint32_t next;
+    uint32_t group;
+  };
+  std::vector<uint32_t> open(group_count, 0);
+  std::vector<Frame> stack;
+  stack.push_back(Frame{n, offsets[n], kNoGroup});
+  while (!stack.empty()) {
+    Frame& frame = stack.back();
+    if (frame.next == offsets[frame.node + 1]) {
+      if (frame.group != kNoGroup) open[frame.group]--;
+      stack.pop_back();
+      continue;
+    }
+
+    uint32_t v = children[frame.next++];
+    uint32_t g = group(nodes_[v]);
+    if (g >= group_count) g = kNoGroup;
+    if (g != kNoGroup) {
+      if (open[g] == 0) sizes[g] += retained_[v];
+      open[g]++;
+    }
+    stack.push_back(Frame{v, offsets[v], g});
+  }
+}
+
+}  // namespace llnode
@@ -0,0 +1,152 @@
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+
+#include "src/error.h"
+#include "src/layout-profile.h"
+
+namespace llnode {
+
+// Bump whenever the meaning of a line changes
+static const char kLayoutProfileHeader[] = "llnode-layout-profile 1";
+
+
+LayoutProfile& LayoutProfile::Get(lldb::SBTarget target) {
+  static lldb::SBTarget profiled_target;
+  static LayoutProfile profile;
+
+  if (!profiled_target.IsValid() || profiled_target != target) {
+    profile.Open(target);
+    profiled_target = target;
+  }
+  return profile;
+}
+
+
+/* Profiles are enabled by LLNODE_LAYOUT_DIR and need the executable to have
+ * a build-id, a profile is never shared between two different binaries.
+ */
+void LayoutProfile::Open(lldb::SBTarget target) {
+  Close();
+  path_.clear();
+  build_id_.clear();
+  values_.clear();
+  found_count_ = 0;
+  failed_ = false;
+
+  const char* dir = getenv("LLNODE_LAYOUT_DIR");
+  if (dir == nullptr || *dir == '\0') return;
+
+  // The executable is always the first module of a target
+  const char* build_id = target.GetModuleAtIndex(0).GetUUIDString();
+  if (build_id == nullptr || *build_id == '\0') return;
+
+  build_id_ = build_id;
+  path_ = std::string(dir) + "/" + build_id_ + ".layout";
+  if (Read()) {
+    Error::PrintInDebugMode("Loaded %zu constants from layout profile '%s'",
+                            values_.size(), path_.c_str());
+  }
+}
+
+
+void LayoutProfile::Close() {
+  if (file_ == nullptr) return;
+
+  fclose(file_);
+  file_ = nullptr;
+}
+
+
+/* Lines cut short by a session that died while appending are skipped, the
+ * constants in them are looked up again.
+ */
+bool LayoutProfile::Read() {
+  FILE* file = fopen(path_.c_str(), "r");
+  if (file == nullptr) return false;
+
+  char line[1024];
+  std::string header = std::string(kLayoutProfileHeader) + " " + build_id_;
+  bool valid = fgets(line, sizeof(line), file) != nullptr &&
+               strncmp(line, header.c_str(), header.size()) == 0 &&
+               (line[header.size()] == '\n' || line[header.size()] == '\0');
+
+  while (valid && fgets(line, sizeof(line), file) != nullptr) {
+    char* end = strchr(line, '\n');
+    if (end == nullptr) continue;
+    *end = '\0';
+
+    char* separator = strchr(line, ' ');
+    if (separator == nullptr || separator == line) continue;
+    *separator = '\0';
+    const char* token = separator + 1;
+
+    Entry entry = {false, -1};
+    if (strcmp(token, "-") != 0) {
+      char* parsed;
+      entry.value = strtoll(token, &parsed, 10);
+      if (*token == '\0' || *parsed != '\0') continue;
+      entry.found = true;
+    }
+    values_[line] = entry;
+  }
+  fclose(file);
+
+  for (const auto& value : values_)
+    if (value.second.found) found_count_++;
+
+  if (!valid) {
+    // Not ours to append to
+    Error::PrintInDebugMode("Ignoring invalid layout profile '%s'",
+                            path_.c_str());
+    values_.clear();
+    found_count_ = 0;
+    failed_ = true;
+    return false;
+  }
+  return true;
+}
+
+
+LayoutProfile::Result LayoutProfile::Find(const char* name,
+                                          int64_t& value) const {
+  auto it = values_.find(name);
+  if (it == values_.end()) return kUnknown;
+  if (!it->second.found) return found_count_ == 0 ? kUnknown : kMissing;
+
+  value = it->second.value;
+  return kFound;
+}
+
+
+void LayoutProfile::Record(const char* name, bool found, int64_t value) {
+  if (!IsEnabled() || failed_) return;
+  auto it = values_.find(name);
+  if (it != values_.end() && (it->second.found || !found)) return;
+  values_[name] = Entry{found, value};
+  if (found) found_count_++;
+
+  if (file_ == nullptr) {
+    file_ = fopen(path_.c_str(), "a");
+    if (file_ == nullptr) {
+      Error::PrintInDebugMode("Failed to open layout profile '%s'",
+                              path_.c_str());
+      failed_ = true;
+      return;
+    }
+
+    fseek(file_, 0, SEEK_END);
+    if (ftell(file_) == 0)
+      fprintf(file_, "%s %s\n", kLayoutProfileHeader, build_id_.c_str());
+  }
+
+  if (found)
+    fprintf(file_, "%s %" PRId64 "\n", name, value);
+  else
+    fprintf(file_, "%s -\n", name);
+
+  // Sessions may end without unloading the plugin, don't keep lines buffered
+  fflush(file_);
+}
+
+}  // namespace llnode
@@ -0,0 +1,64 @@
+#ifndef SRC_LAYOUT_PROFILE_H_
+#define SRC_LAYOUT_PROFILE_H_
+
+#include <lldb/API/LLDB.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+
+namespace llnode {
+
+/* Values of the postmortem constants of one node build, kept in
+ * `$LLNODE_LAYOUT_DIR/<build-id>.layout` so later sessions on the same build
+ * don't look up any symbol.
+ *
+ * The file is text, a header line followed by one `<name> <value>` line per
+ * constant, or `<name> -` for a constant the binary doesn't have. Constants
+ * are appended as they are first looked up, so a profile grows with the
+ * commands used, and the last line of a constant wins. Stripping a binary
+ * keeps its build-id, so the profile of an unstripped build also serves the
+ * stripped one. Misses are only trusted once the profile has a constant that
+ * was found, so a profile started on a stripped copy is filled in by a later
+ * session on the unstripped build.
+ */
+class LayoutProfile {
+ public:
+  enum Result { kUnknown, kFound, kMissing };
+
+  // Profile of `target`'s executable, kept until a different target is used
+  static LayoutProfile& Get(lldb::SBTarget target);
+
+  ~LayoutProfile() { Close(); }
+
+  Result Find(const char* name, int64_t& value) const;
+
+  // Remembers a constant looked up from the symbols, `found` if it exists.
+  // A constant found replaces a miss.
+  void Record(const char* name, bool found, int64_t value);
+
+  inline bool IsEnabled() const { return !path_.empty(); }
+  inline size_t size() const { return values_.size(); }
+
+ private:
+  struct Entry {
+    bool found;
+    int64_t value;
+  };
+
+  void Open(lldb::SBTarget target);
+  void Close();
+  bool Read();
+
+  std::string path_;
+  std::string build_id_;
+  FILE* file_ = nullptr;
+  bool failed_ = false;
+  std::unordered_map<std::string, Entry> values_;
+  // Number of constants found, misses are unknown without any
+  size_t found_count_ = 0;
+};
+
+}  // namespace llnode
+
+#endif  // SRC_LAYOUT_PROFILE_H_
@@ -41,6 +41,7 @@ LLNodeApi::LLNodeApi(LLNode* llnode)
       target(new SBTarget()),
       process(new SBProcess()),
       llv8(new LLV8()),
+      node(new node::Node(llv8.get())),
       llscan(new LLScan(llv8.get(), llnode)) {}
 LLNodeApi::~LLNodeApi(){};
 
@@ -64,7 +65,9 @@ int LLNodeApi::LoadCore() {
     return 2;
   }
   // Load V8 constants from postmortem data
+  llscan->v8()->SetCoreFile(core->core);
   llscan->v8()->Load(*target);
+  node->Load(*target);
   return 0;
 }
 
@@ -305,7 +308,7 @@ string** LLNodeApi::GetTypeInstances(size_t type_index, int type) {
   }
   uint32_t length = objet_types[type_index]->GetInstanceCount();
   string** instances = new string*[length];
-  std::unordered_set<uint64_t> list = objet_types[type_index]->GetInstances();
+  auto list = objet_types[type_index]->GetInstances();
   uint32_t index = 0;
   for (auto it = list.begin(); it != list.end(); ++it) {
     char buf[20];
@@ -371,4 +374,12 @@ bool LLNodeApi::ExportString(uint64_t address, char* file) {
   outfile.close();
   return true;
 }
+
+std::vector<RetainerPath> LLNodeApi::GetRetainers(uint64_t address,
+                                                  uint32_t max_depth,
+                                                  uint32_t max_paths) {
+  std::vector<RetainerPath> paths;
+  llscan->FindRetainers(address, node.get(), max_depth, max_paths, paths);
+  return paths;
+}
 }  // namespace llnode
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include <memory>
+#include "src/heap-graph.h"
 #include "src/llnode-common.h"
 
 namespace lldb {
@@ -23,6 +24,10 @@ namespace v8 {
 class LLV8;
 }
 
+namespace node {
+class Node;
+}
+
 typedef std::unordered_map<long long, frame_t*> FrameMap;
 typedef std::unordered_map<std::string, inspect_t*> InspectMap;
 typedef std::unordered_map<std::string, std::string**> InstancesMap;
@@ -55,6 +60,8 @@ class LLNodeApi {
   inspect_t* Inspect(uint64_t address, bool detailed, unsigned int current = 0,
                      unsigned int limit = 0);
   bool ExportString(uint64_t address, char* file);
+  std::vector<RetainerPath> GetRetainers(uint64_t address, uint32_t max_depth,
+                                         uint32_t max_paths);
 
  private:
   LLNode* llnode;
@@ -66,6 +73,7 @@ class LLNodeApi {
   std::unique_ptr<lldb::SBTarget> target;
   std::unique_ptr<lldb::SBProcess> process;
   std::unique_ptr<v8::LLV8> llv8;
+  std::unique_ptr<node::Node> node;
   std::unique_ptr<LLScan> llscan;
   std::vector<TypeRecord*> object_types_by_count;
   std::vector<TypeRecord*> object_types_by_size;
@@ -280,6 +280,8 @@ typedef struct JsRegexp : inspect_t {
   }
 } js_regexp_t;
 
+// Lengths and offsets are in UTF-16 code units, like String.length in
+// JavaScript, `display_value` is UTF-8
 typedef struct FirstNonString : inspect_t {
   int total_length = 0;
   std::string display_value = "";
@@ -1,5 +1,7 @@
 #include "src/llnode-module.h"
 
+#include <cmath>
+
 namespace llnode {
 using ::v8::Array;
 using ::v8::Boolean;
@@ -31,6 +33,19 @@ pagination_t<T>* GetPagination(Local<Value> in_curt, Local<Value> in_limt,
   return pagination;
 }
 
+// Reads the count `name` of `options` into `value`, which is left alone if
+// it isn't a number. Returns false for negative or non-finite counts.
+static bool GetCountOption(Local<Object> options, const char* name,
+                           uint32_t* value) {
+  Local<Value> option = options->Get(Nan::New<String>(name).ToLocalChecked());
+  if (!option->IsNumber()) return true;
+
+  double count = option->NumberValue();
+  if (!std::isfinite(count) || count < 0) return false;
+  *value = count >= UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(count);
+  return true;
+}
+
 template <typename T>
 Local<Array> GetDisPlayElements(T* eles) {
   if (eles->elements != nullptr) {
@@ -83,6 +98,7 @@ void LLNode::Init(Local<Object> exports) {
   Nan::SetPrototypeMethod(tpl, "inspectJsObjectAtAddress",
                           InspectJsObjectAtAddress);
   Nan::SetPrototypeMethod(tpl, "exportStringAtAddress", ExportStringAtAddress);
+  Nan::SetPrototypeMethod(tpl, "getRetainersAtAddress", GetRetainersAtAddress);
   // return js class
   constructor.Reset(tpl->GetFunction());
   exports->Set(Nan::New("LLNode").ToLocalChecked(), tpl->GetFunction());
@@ -825,4 +841,51 @@ void LLNode::ExportStringAtAddress(
   bool export_string = llnode->api->ExportString(addr, *full_file_path);
   info.GetReturnValue().Set(Nan::New<Boolean>(export_string));
 }
+
+void LLNode::GetRetainersAtAddress(
+    const Nan::FunctionCallbackInfo<Value>& info) {
+  Nan::Utf8String address_str(info[0]);
+  if ((*address_str)[0] != '0' || (*address_str)[1] != 'x' ||
+      address_str.length() > 18) {
+    Nan::ThrowTypeError("Invalid address");
+    return;
+  }
+  uint32_t depth = 16;
+  uint32_t paths = 5;
+  if (info[1]->IsObject()) {
+    Local<Object> options = info[1]->ToObject();
+    if (!GetCountOption(options, "depth", &depth)) {
+      Nan::ThrowTypeError("options.depth must be a non-negative number");
+      return;
+    }
+    if (!GetCountOption(options, "paths", &paths)) {
+      Nan::ThrowTypeError("options.paths must be a non-negative number");
+      return;
+    }
+  }
+  LLNode* llnode = ObjectWrap::Unwrap<LLNode>(info.Holder());
+  if (!llnode->ScanHeap()) {
+    Nan::ThrowTypeError(Nan::New<String>("scan heap error!").ToLocalChecked());
+    info.GetReturnValue().Set(Nan::Undefined());
+    return;
+  }
+  uint64_t addr = std::strtoull(*address_str, nullptr, 16);
+  std::vector<RetainerPath> retainers =
+      llnode->api->GetRetainers(addr, depth, paths);
+  Local<Array> result = Nan::New<Array>(retainers.size());
+  for (size_t i = 0; i < retainers.size(); i++) {
+    Local<Array> objects = Nan::New<Array>(retainers[i].objects.size());
+    for (size_t j = 0; j < retainers[i].objects.size(); j++) {
+      char buf[20];
+      snprintf(buf, sizeof(buf), "0x%016" PRIx64, retainers[i].objects[j]);
+      objects->Set(j, Nan::New<String>(buf).ToLocalChecked());
+    }
+    Local<Object> path = Nan::New<Object>();
+    path->Set(Nan::New<String>("root").ToLocalChecked(),
+              Nan::New<String>(retainers[i].root).ToLocalChecked());
+    path->Set(Nan::New<String>("objects").ToLocalChecked(), objects);
+    result->Set(i, path);
+  }
+  info.GetReturnValue().Set(result);
+}
 }  // namespace llnode
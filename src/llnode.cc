@@ -404,11 +404,13 @@ bool PluginInitialize(SBDebugger d) {
   interpreter.AddCommand("jssource", new llnode::ListCmd(&llv8),
                          "Alias for `v8 source list`");
 
-  v8.AddCommand("findjsobjects", new llnode::FindObjectsCmd(&llscan),
+  v8.AddCommand("findjsobjects", new llnode::FindObjectsCmd(&llscan, &node),
                 "List all object types and instance counts grouped by type "
                 "name and sorted by instance count. Use -d or --detailed to "
                 "get an output grouped by type name, properties, and array "
-                "length, as well as more information regarding each type.\n"
+                "length, as well as more information regarding each type. "
+                "Use -r or --retained to also compute the size each type "
+                "retains and sort by it.\n"
 #ifndef LLDB_SBMemoryRegionInfoList_h_
                 "Requires `LLNODE_RANGESFILE` environment variable to be set "
                 "to a file containing memory ranges for the core file being "
@@ -418,7 +420,8 @@ bool PluginInitialize(SBDebugger d) {
 #endif  // LLDB_SBMemoryRegionInfoList_h_
   );
 
-  interpreter.AddCommand("findjsobjects", new llnode::FindObjectsCmd(&llscan),
+  interpreter.AddCommand("findjsobjects",
+                         new llnode::FindObjectsCmd(&llscan, &node),
                          "Alias for `v8 findjsobjects`");
 
   v8.AddCommand("findjsinstances", new llnode::FindInstancesCmd(&llscan, false),
@@ -445,7 +448,40 @@ bool PluginInitialize(SBDebugger d) {
       " * -n, --name  name     - all properties with the specified name\n"
       " * -s, --string string  - all properties that refer to the specified "
       "JavaScript string value\n"
-      "\n");
+      "\n"
+      "Several names or strings can be given at once, names are all searched "
+      "for in a single pass over the heap and strings are looked up in an "
+      "index of the string contents built on first use. Every argument is a "
+      "separate name or string, quote those containing spaces.\n");
+
+  v8.AddCommand(
+      "findstrings", new llnode::FindStringsCmd(&llscan),
+      "List the JavaScript strings equal to the specified text. The contents "
+      "of all strings are indexed on first use. Quote text containing "
+      "spaces.\n"
+      "Flags:\n\n"
+      " * -c, --contains  - strings containing the text instead\n"
+      " * -p, --prefix    - strings starting with the text instead\n"
+      "\n"
+      "Syntax: v8 findstrings [flags] text\n");
+
+  v8.AddCommand(
+      "retainers", new llnode::RetainersCmd(&llscan, &node),
+      "Print the shortest chains of references keeping the specified "
+      "JavaScript object alive. A chain ends at a global object, a native "
+      "context, the process object, an active handle or request, or an "
+      "object with no known referrers.\n"
+      "Flags:\n\n"
+      " * -d, --depth num  - follow at most `num` references (default 16)\n"
+      " * -p, --paths num  - print at most `num` chains (default 5)\n"
+      "\n"
+      "Syntax: v8 retainers [flags] expr\n");
+
+  v8.AddCommand("retained", new llnode::RetainedCmd(&llscan, &node),
+                "Print the size the specified JavaScript object retains, its "
+                "immediate dominator and the largest objects it dominates.\n"
+                "\n"
+                "Syntax: v8 retained expr\n");
 
   v8.AddCommand("getactivehandles",
                 new llnode::GetActiveHandlesCmd(&llv8, &node),
@@ -54,6 +54,7 @@ bool LLNodeApi::Init(const char* filename, const char* executable) {
     return false;
   }
   // Load V8 constants from postmortem data
+  llscan->v8()->SetCoreFile(filename);
   llscan->v8()->Load(*target);
   initialized_ = true;
 
@@ -177,11 +178,11 @@ uint32_t LLNodeApi::GetTypeTotalSize(size_t type_index) {
   return object_types[type_index]->GetTotalInstanceSize();
 }
 
-std::unordered_set<uint64_t>* LLNodeApi::GetTypeInstances(size_t type_index) {
+InstanceRange LLNodeApi::GetTypeInstances(size_t type_index) {
   if (object_types.size() <= type_index) {
-    return nullptr;
+    return InstanceRange();
   }
-  return &(object_types[type_index]->GetInstances());
+  return object_types[type_index]->GetInstances();
 }
 
 std::string LLNodeApi::GetObject(uint64_t address) {
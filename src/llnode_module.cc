@@ -255,11 +255,10 @@ LLNode* LLNodeHeapType::llnode() {
 }
 
 void LLNodeHeapType::InitInstances() {
-  auto instances_set =
-      this->llnode()->api_->GetTypeInstances(this->type_index_);
+  auto instances = this->llnode()->api_->GetTypeInstances(this->type_index_);
   this->current_instance_index_ = 0;
 
-  for (const uint64_t& addr : *instances_set) {
+  for (uint64_t addr : instances) {
     this->type_instances_.push_back(addr);
   }
 
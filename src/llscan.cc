@@ -4,8 +4,11 @@
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
 #include <fstream>
+#include <thread>
 #include <vector>
 
 #include <lldb/API/SBExpressionOptions.h>
@@ -14,6 +17,7 @@
 #include "src/llnode.h"
 #include "src/llscan.h"
 #include "src/llv8-inl.h"
+#include "src/node-inl.h"
 
 namespace llnode {
 
@@ -114,13 +118,26 @@ bool FindObjectsCmd::DoExecute(SBDebugger d, char** cmd,
     return false;
   }
 
-  v8::Value::InspectOptions inspect_options;
-  ParseInspectOptions(cmd, &inspect_options);
+  bool detailed = false;
+  bool retained = false;
+  ParseFindObjectsOptions(cmd, &detailed, &retained);
+
+  RetainedSizeMap retained_sizes;
+  if (retained) {
+    // Retained sizes come from the dominator tree of the references
+    node_->Load(target);
+    if (!llscan_->LoadDominatorTree(node_)) {
+      result.SetError("The heap graph is too large to compute retained sizes");
+      result.SetStatus(eReturnStatusFailed);
+      return false;
+    }
+    llscan_->GetTypeRetainedSizes(detailed, retained_sizes);
+  }
 
-  if (inspect_options.detailed) {
-    DetailedOutput(result);
+  if (detailed) {
+    DetailedOutput(result, retained ? &retained_sizes : nullptr);
   } else {
-    SimpleOutput(result);
+    SimpleOutput(result, retained ? &retained_sizes : nullptr);
   }
 
   result.SetStatus(eReturnStatusSuccessFinishResult);
@@ -128,7 +145,70 @@ bool FindObjectsCmd::DoExecute(SBDebugger d, char** cmd,
 }
 
 
-void FindObjectsCmd::SimpleOutput(SBCommandReturnObject& result) {
+char** FindObjectsCmd::ParseFindObjectsOptions(char** cmd, bool* detailed,
+                                               bool* retained) {
+  static struct option opts[] = {{"detailed", no_argument, nullptr, 'd'},
+                                 {"verbose", no_argument, nullptr, 'v'},
+                                 {"retained", no_argument, nullptr, 'r'},
+                                 {nullptr, 0, nullptr, 0}};
+
+  int argc = 1;
+  for (char** p = cmd; p != nullptr && *p != nullptr; p++) argc++;
+
+  char* args[argc];
+
+  // Make this look like a command line, we need a valid element at index 0
+  // for getopt_long to use in its error messages.
+  char name[] = "llscan";
+  args[0] = name;
+  for (int i = 0; i < argc - 1; i++) args[i + 1] = cmd[i];
+
+  // Reset getopts.
+  optind = 0;
+  opterr = 1;
+  do {
+    int arg = getopt_long(argc, args, "dvr", opts, nullptr);
+    if (arg == -1) break;
+
+    switch (arg) {
+      case 'd':
+      case 'v':
+        *detailed = true;
+        break;
+      case 'r':
+        *retained = true;
+        break;
+      default:
+        continue;
+    }
+  } while (true);
+
+  return &cmd[optind - 1];
+}
+
+
+/* Sort by retained size when known, by instance count otherwise. */
+static void SortTypeRecords(std::vector<TypeRecord*>& records,
+                            const RetainedSizeMap* retained) {
+  if (retained == nullptr) {
+    std::sort(records.begin(), records.end(),
+              TypeRecord::CompareInstanceCounts);
+    return;
+  }
+
+  std::sort(records.begin(), records.end(),
+            [retained](TypeRecord* a, TypeRecord* b) {
+              uint64_t a_size = retained->at(a);
+              uint64_t b_size = retained->at(b);
+              if (a_size == b_size)
+                return TypeRecord::CompareInstanceCounts(a, b);
+              return a_size > b_size;
+            });
+}
+
+
+void FindObjectsCmd::SimpleOutput(SBCommandReturnObject& result,
+                                  const RetainedSizeMap* retained) {
   /* Create a vector to hold the entries sorted by instance count
    * TODO(hhellyer) - Make sort type an option (by count, size or name)
    */
@@ -139,51 +219,95 @@ void FindObjectsCmd::SimpleOutput(SBCommandReturnObject& result) {
     sorted_by_count.push_back(it->second);
   }
 
-  std::sort(sorted_by_count.begin(), sorted_by_count.end(),
-            TypeRecord::CompareInstanceCounts);
+  SortTypeRecords(sorted_by_count, retained);
 
   uint64_t total_objects = 0;
   uint64_t total_size = 0;
 
-  result.Printf(" Instances  Total Size Name\n");
-  result.Printf(" ---------- ---------- ----\n");
+  if (retained != nullptr) {
+    result.Printf(" Instances  Total Size   Retained Size Name\n");
+    result.Printf(" ---------- ---------- --------------- ----\n");
+  } else {
+    result.Printf(" Instances  Total Size Name\n");
+    result.Printf(" ---------- ---------- ----\n");
+  }
 
   for (std::vector<TypeRecord*>::iterator it = sorted_by_count.begin();
        it != sorted_by_count.end(); ++it) {
     TypeRecord* t = *it;
-    result.Printf(" %10" PRId64 " %10" PRId64 " %s\n", t->GetInstanceCount(),
-                  t->GetTotalInstanceSize(), t->GetTypeName().c_str());
+    if (retained != nullptr) {
+      result.Printf(" %10" PRId64 " %10" PRId64 " %15" PRIu64 " %s\n",
+                    t->GetInstanceCount(), t->GetTotalInstanceSize(),
+                    retained->at(t), t->GetTypeName().c_str());
+    } else {
+      result.Printf(" %10" PRId64 " %10" PRId64 " %s\n", t->GetInstanceCount(),
+                    t->GetTotalInstanceSize(), t->GetTypeName().c_str());
+    }
     total_objects += t->GetInstanceCount();
     total_size += t->GetTotalInstanceSize();
   }
 
+  // Retained sizes of different types overlap, they have no total
   result.Printf(" ---------- ---------- \n");
   result.Printf(" %10" PRId64 " %10" PRId64 " \n", total_objects, total_size);
+
+  if (!llscan_->AreHeapPagesLoaded()) return;
+
+  result.Printf("\n Instances  Total Size Space\n");
+  result.Printf(" ---------- ---------- -----\n");
+  for (int i = 0; i <= v8::MemoryChunk::kUnknownSpace; i++) {
+    v8::MemoryChunk::Space space = static_cast<v8::MemoryChunk::Space>(i);
+    const LLScan::SpaceStatistics& statistics =
+        llscan_->GetSpaceStatistics(space);
+    if (statistics.count == 0) continue;
+
+    result.Printf(" %10" PRId64 " %10" PRId64 " %s\n", statistics.count,
+                  statistics.size, v8::MemoryChunk::SpaceName(space));
+  }
 }
 
 
-void FindObjectsCmd::DetailedOutput(SBCommandReturnObject& result) {
-  std::vector<DetailedTypeRecord*> sorted_by_count;
+void FindObjectsCmd::DetailedOutput(SBCommandReturnObject& result,
+                                    const RetainedSizeMap* retained) {
+  std::vector<TypeRecord*> sorted_by_count;
   for (auto kv : llscan_->GetDetailedMapsToInstances()) {
     sorted_by_count.push_back(kv.second);
   }
 
-  std::sort(sorted_by_count.begin(), sorted_by_count.end(),
-            TypeRecord::CompareInstanceCounts);
+  SortTypeRecords(sorted_by_count, retained);
   uint64_t total_objects = 0;
   uint64_t total_size = 0;
 
-  result.Printf(
-      "   Sample Obj.  Instances  Total Size  Properties  Elements  Name\n");
-  result.Printf(
-      " ------------- ---------- ----------- ----------- --------- -----\n");
-
-  for (auto t : sorted_by_count) {
-    result.Printf(" %13" PRIx64 " %10" PRId64 " %11" PRId64 " %11" PRId64
-                  " %9" PRId64 " %s\n",
-                  *(t->GetInstances().begin()), t->GetInstanceCount(),
-                  t->GetTotalInstanceSize(), t->GetOwnDescriptorsCount(),
-                  t->GetIndexedPropertiesCount(), t->GetTypeName().c_str());
+  if (retained != nullptr) {
+    result.Printf(
+        "   Sample Obj.  Instances  Total Size   Retained Size  Properties  "
+        "Elements  Name\n");
+    result.Printf(
+        " ------------- ---------- ----------- --------------- ----------- "
+        "--------- -----\n");
+  } else {
+    result.Printf(
+        "   Sample Obj.  Instances  Total Size  Properties  Elements  Name\n");
+    result.Printf(
+        " ------------- ---------- ----------- ----------- --------- -----\n");
+  }
+
+  for (auto record : sorted_by_count) {
+    DetailedTypeRecord* t = static_cast<DetailedTypeRecord*>(record);
+    if (retained != nullptr) {
+      result.Printf(" %13" PRIx64 " %10" PRId64 " %11" PRId64 " %15" PRIu64
+                    " %11" PRId64 " %9" PRId64 " %s\n",
+                    *(t->GetInstances().begin()), t->GetInstanceCount(),
+                    t->GetTotalInstanceSize(), retained->at(t),
+                    t->GetOwnDescriptorsCount(),
+                    t->GetIndexedPropertiesCount(), t->GetTypeName().c_str());
+    } else {
+      result.Printf(" %13" PRIx64 " %10" PRId64 " %11" PRId64 " %11" PRId64
+                    " %9" PRId64 " %s\n",
+                    *(t->GetInstances().begin()), t->GetInstanceCount(),
+                    t->GetTotalInstanceSize(), t->GetOwnDescriptorsCount(),
+                    t->GetIndexedPropertiesCount(), t->GetTypeName().c_str());
+    }
     total_objects += t->GetInstanceCount();
     total_size += t->GetTotalInstanceSize();
   }
@@ -232,8 +356,8 @@ bool FindInstancesCmd::DoExecute(SBDebugger d, char** cmd,
       llscan_->GetMapsToInstances().find(type_name);
   if (instance_it != llscan_->GetMapsToInstances().end()) {
     TypeRecord* t = instance_it->second;
-    for (std::unordered_set<uint64_t>::iterator it = t->GetInstances().begin();
-         it != t->GetInstances().end(); ++it) {
+    for (auto it = t->GetInstances().begin(); it != t->GetInstances().end();
+         ++it) {
       Error err;
       v8::Value v8_value(llscan_->v8(), *it);
       std::string res = v8_value.Inspect(&inspect_options, err);
@@ -481,25 +605,17 @@ bool FindReferencesCmd::DoExecute(SBDebugger d, char** cmd,
       break;
     }
     case ScanType::kPropertyName: {
-      // Check for extra parameters or parameters that needed quoting.
-      if (start[1] != nullptr) {
-        result.SetError("Extra search parameter or unquoted string specified.");
-        result.SetStatus(eReturnStatusFailed);
-        return false;
-      }
-      std::string property_name = start[0];
-      scanner = new PropertyScanner(llscan_, property_name);
+      // Every parameter is a property name, all are searched in one pass
+      std::vector<std::string> property_names;
+      for (; *start != nullptr; start++) property_names.push_back(*start);
+      scanner = new PropertyScanner(llscan_, property_names);
       break;
     }
     case ScanType::kStringValue: {
-      // Check for extra parameters or parameters that needed quoting.
-      if (start[1] != nullptr) {
-        result.SetError("Extra search parameter or unquoted string specified.");
-        result.SetStatus(eReturnStatusFailed);
-        return false;
-      }
-      std::string string_value = start[0];
-      scanner = new StringScanner(llscan_, string_value);
+      // Every parameter is a string, all are searched in one pass
+      std::vector<std::string> string_values;
+      for (; *start != nullptr; start++) string_values.push_back(*start);
+      scanner = new StringScanner(llscan_, string_values);
       break;
     }
     /* We can add options to the command and further sub-classes of
@@ -527,8 +643,18 @@ bool FindReferencesCmd::DoExecute(SBDebugger d, char** cmd,
   if (!scanner->AreReferencesLoaded()) {
     ScanForReferences(scanner);
   }
-  ReferencesVector* references = scanner->GetReferences();
-  PrintReferences(result, references, scanner);
+
+  size_t count = scanner->GetSearchValueCount();
+  for (size_t i = 0; i < count; i++) {
+    scanner->SelectSearchValue(i);
+    if (count > 1) {
+      result.Printf("%sReferences to '%s':\n", i == 0 ? "" : "\n",
+                    scanner->GetSearchValue(i).c_str());
+    }
+
+    ReferencesVector* references = scanner->GetReferences();
+    PrintReferences(result, references, scanner);
+  }
 
   delete scanner;
 
@@ -539,40 +665,53 @@ bool FindReferencesCmd::DoExecute(SBDebugger d, char** cmd,
 
 void FindReferencesCmd::ScanForReferences(ObjectScanner* scanner) {
   // Walk all the object instances and handle them according to their type.
-  TypeRecordMap mapstoinstances = llscan_->GetMapsToInstances();
-  for (auto const entry : mapstoinstances) {
-    TypeRecord* typerecord = entry.second;
-    for (uint64_t addr : typerecord->GetInstances()) {
-      Error err;
-      v8::Value obj_value(llscan_->v8(), addr);
-      v8::HeapObject heap_object(obj_value);
-      int64_t type = heap_object.GetType(err);
-      v8::LLV8* v8 = heap_object.v8();
-
-      // We only need to handle the types that are in
-      // FindJSObjectsVisitor::IsAHistogramType
-      // as those are the only objects that end up in GetMapsToInstances
-      if (v8::JSObject::IsObjectType(v8, type) ||
-          type == v8->types()->kJSArrayType) {
-        // Objects can have elements and arrays can have named properties.
-        // Basically we need to access objects and arrays as both objects and
-        // arrays.
-        v8::JSObject js_obj(heap_object);
-        scanner->ScanRefs(js_obj, err);
-
-      } else if (type < v8->types()->kFirstNonstringType) {
-        v8::String str(heap_object);
-        scanner->ScanRefs(str, err);
-
-      } else if (type == v8->types()->kJSTypedArrayType) {
-        // These should only point to off heap memory,
-        // this case should be a no-op.
-      } else {
-        // result.Printf("Unhandled type: %" PRId64 " for addr %" PRIx64
-        //    "\n", type, addr);
-      }
+  // The object table knows the map of every object, so the type is only
+  // read once per map.
+  ObjectTable& objects = llscan_->GetObjectTable();
+  v8::LLV8* v8 = llscan_->v8();
+  AddressMap<int64_t> map_types;
+  for (uint32_t row = 0; row < objects.size(); row++) {
+    Error err;
+    v8::Map map(v8, objects.GetMap(row));
+    int64_t* cached_type = map_types.Find(map.raw());
+    int64_t type;
+    if (cached_type != nullptr) {
+      type = *cached_type;
+    } else {
+      type = map.GetType(err);
+      if (err.Fail()) type = -1;
+      map_types.Insert(map.raw(), type);
+    }
+
+    v8::HeapObject heap_object(v8, objects.GetAddress(row));
+
+    // We only need to handle the types that are in
+    // FindJSObjectsVisitor::IsAHistogramType
+    // as those are the only objects that end up in GetMapsToInstances
+    if (type == -1) {
+      // The map can't be read, neither can the object
+    } else if (v8::JSObject::IsObjectType(v8, type) ||
+               type == v8->types()->kJSArrayType) {
+      // Objects can have elements and arrays can have named properties.
+      // Basically we need to access objects and arrays as both objects and
+      // arrays.
+      v8::JSObject js_obj(heap_object);
+      scanner->ScanObjectRefs(js_obj, map, err);
+
+    } else if (type < v8->types()->kFirstNonstringType) {
+      v8::String str(heap_object);
+      scanner->ScanRefs(str, err);
+
+    } else if (type == v8->types()->kJSTypedArrayType) {
+      // These should only point to off heap memory,
+      // this case should be a no-op.
+    } else {
+      // result.Printf("Unhandled type: %" PRId64 " for addr %" PRIx64
+      //    "\n", type, addr);
     }
   }
+
+  scanner->ScanFinished();
 }
 
 
@@ -785,10 +924,11 @@ void FindReferencesCmd::ReferenceScanner::PrintRefs(
 }
 
 
+// References are only collected here, duplicates are dropped when the
+// index is built by ScanFinished().
 void FindReferencesCmd::ReferenceScanner::ScanRefs(v8::JSObject& js_obj,
                                                    Error& err) {
-  ReferencesVector* references;
-  std::set<uint64_t> already_saved;
+  ReferenceIndex& references = llscan_->GetReferencesByValue();
 
   int64_t length = js_obj.GetArrayLength(err);
   for (int64_t i = 0; i < length; ++i) {
@@ -796,11 +936,8 @@ void FindReferencesCmd::ReferenceScanner::ScanRefs(v8::JSObject& js_obj,
 
     // Array is borked, or not array at all - skip it
     if (!err.Success()) break;
-    if (already_saved.count(v.raw())) continue;
 
-    references = llscan_->GetReferencesByValue(v.raw());
-    references->push_back(js_obj.raw());
-    already_saved.insert(v.raw());
+    references.AddReference(js_obj.raw(), v.raw());
   }
 
   // Walk all the properties in this object.
@@ -811,21 +948,14 @@ void FindReferencesCmd::ReferenceScanner::ScanRefs(v8::JSObject& js_obj,
     return;
   }
   for (auto entry : entries) {
-    v8::Value v = entry.second;
-
-    if (already_saved.count(v.raw())) continue;
-
-    references = llscan_->GetReferencesByValue(v.raw());
-    references->push_back(js_obj.raw());
-    already_saved.insert(v.raw());
+    references.AddReference(js_obj.raw(), entry.second.raw());
   }
 }
 
 
 void FindReferencesCmd::ReferenceScanner::ScanRefs(v8::String& str,
                                                    Error& err) {
-  ReferencesVector* references;
-  std::set<uint64_t> already_saved;
+  ReferenceIndex& references = llscan_->GetReferencesByValue();
 
   v8::LLV8* v8 = str.v8();
 
@@ -838,33 +968,21 @@ void FindReferencesCmd::ReferenceScanner::ScanRefs(v8::String& str,
     v8::SlicedString sliced_str(str);
     v8::String parent = sliced_str.Parent(err);
 
-    if (err.Success()) {
-      references = llscan_->GetReferencesByValue(parent.raw());
-      references->push_back(str.raw());
-    }
+    if (err.Success()) references.AddReference(str.raw(), parent.raw());
 
   } else if (repr == v8->string()->kConsStringTag) {
     v8::ConsString cons_str(str);
 
     v8::String first = cons_str.First(err);
-    if (err.Success()) {
-      references = llscan_->GetReferencesByValue(first.raw());
-      references->push_back(str.raw());
-    }
+    if (err.Success()) references.AddReference(str.raw(), first.raw());
 
     v8::String second = cons_str.Second(err);
-    if (err.Success() && first.raw() != second.raw()) {
-      references = llscan_->GetReferencesByValue(second.raw());
-      references->push_back(str.raw());
-    }
+    if (err.Success()) references.AddReference(str.raw(), second.raw());
   } else if (repr == v8->string()->kThinStringTag) {
     v8::ThinString thin_str(str);
     v8::String actual = thin_str.Actual(err);
 
-    if (err.Success()) {
-      references = llscan_->GetReferencesByValue(actual.raw());
-      references->push_back(str.raw());
-    }
+    if (err.Success()) references.AddReference(str.raw(), actual.raw());
   }
   // Nothing to do for other kinds of string.
 }
@@ -875,8 +993,37 @@ bool FindReferencesCmd::ReferenceScanner::AreReferencesLoaded() {
 }
 
 
+void FindReferencesCmd::ReferenceScanner::ScanFinished() {
+  // Closures keep their variables alive through contexts, record those
+  // references too so retainer paths can go through them. They are printed
+  // by PrintContextRefs().
+  ReferenceIndex& references = llscan_->GetReferencesByValue();
+  for (uint64_t ctx : *llscan_->GetContexts()) {
+    Error err;
+    v8::HeapObject context_obj(llscan_->v8(), ctx);
+    v8::Context c(context_obj);
+
+    v8::Value previous = c.Previous(err);
+    if (err.Success()) references.AddReference(ctx, previous.raw());
+
+    v8::Context::Locals locals(&c, err);
+    if (err.Fail()) continue;
+
+    for (v8::Context::Locals::Iterator it = locals.begin(); it != locals.end();
+         it++) {
+      references.AddReference(ctx, (*it).raw());
+    }
+  }
+
+  llscan_->FinishReferencesByValue();
+}
+
+
 ReferencesVector* FindReferencesCmd::ReferenceScanner::GetReferences() {
-  return llscan_->GetReferencesByValue(search_value_.raw());
+  ReferenceRange references =
+      llscan_->GetReferencesByValue().GetReferences(search_value_.raw());
+  references_.assign(references.begin(), references.end());
+  return &references_;
 }
 
 
@@ -906,32 +1053,124 @@ void FindReferencesCmd::PropertyScanner::PrintRefs(
 }
 
 
+FindReferencesCmd::PropertyScanner::PropertyScanner(
+    LLScan* llscan, const std::vector<std::string>& search_values)
+    : llscan_(llscan), search_values_(search_values) {
+  if (!search_values_.empty()) search_value_ = search_values_[0];
+  for (const std::string& value : search_values_) {
+    if (!llscan_->AreReferencesByPropertyLoaded(value)) pending_.Insert(value);
+  }
+}
+
+
 void FindReferencesCmd::PropertyScanner::ScanRefs(v8::JSObject& js_obj,
                                                   Error& err) {
   // (Note: We skip array elements as they don't have names.)
+  v8::LLV8* v8 = js_obj.v8();
 
   // Walk all the properties in this object.
-  // We only create strings for the field names that match the search
-  // value.
-  ReferencesVector* references;
+  // We only create strings for the field names that may match one of the
+  // search values.
   std::vector<std::pair<v8::Value, v8::Value>> entries = js_obj.Entries(err);
   if (err.Fail()) {
     return;
   }
   for (auto entry : entries) {
     v8::HeapObject nameObj(entry.first);
-    std::string key = entry.first.ToString(err);
+    int64_t type = nameObj.GetType(err);
     if (err.Fail()) {
       continue;
     }
-    references = llscan_->GetReferencesByProperty(key);
-    references->push_back(js_obj.raw());
+    if (type < v8->types()->kFirstNonstringType) {
+      v8::String name(nameObj);
+      if (!pending_.MayContain(name, err)) continue;
+    }
+
+    std::string key = entry.first.ToString(err);
+    if (err.Fail() || !pending_.Contains(key)) {
+      continue;
+    }
+    llscan_->GetReferencesByProperty(key)->push_back(js_obj.raw());
+  }
+}
+
+
+/* Fast mode objects sharing a map have the same property names, so which
+ * of the search values they have is only worked out once per map.
+ * Dictionary mode objects have their own names and are walked one by one.
+ */
+void FindReferencesCmd::PropertyScanner::ScanObjectRefs(v8::JSObject& js_obj,
+                                                        v8::Map& map,
+                                                        Error& err) {
+  uint32_t* index = map_cache_.Find(map.raw());
+  if (index == nullptr) {
+    map_cache_.Insert(map.raw(), map_names_.size());
+    map_names_.push_back(LoadMapNames(map));
+    index = map_cache_.Find(map.raw());
+  }
+
+  const MapNames& names = map_names_[*index];
+  if (names.dictionary) {
+    ScanRefs(js_obj, err);
+    return;
+  }
+  for (const std::string& name : names.names)
+    llscan_->GetReferencesByProperty(name)->push_back(js_obj.raw());
+}
+
+
+FindReferencesCmd::PropertyScanner::MapNames
+FindReferencesCmd::PropertyScanner::LoadMapNames(v8::Map& map) {
+  MapNames names;
+  Error err;
+  names.dictionary = map.IsDictionary(err);
+  if (err.Fail() || names.dictionary) {
+    // Fall back to the object itself
+    names.dictionary = true;
+    return names;
+  }
+
+  v8::LLV8* v8 = map.v8();
+  v8::HeapObject descriptors_obj = map.InstanceDescriptors(err);
+  if (err.Fail()) return names;
+  v8::DescriptorArray descriptors(descriptors_obj);
+
+  int64_t own_descriptors_count = map.NumberOfOwnDescriptors(err);
+  if (err.Fail()) return names;
+  v8::FieldSnapshot descriptor_fields =
+      descriptors.Snapshot(own_descriptors_count);
+
+  // The same names JSObject::Entries() would return, filtered like
+  // ScanRefs() does
+  for (int64_t i = 0; i < own_descriptors_count; i++) {
+    v8::Value key = descriptors.GetKey(descriptor_fields, i, err);
+    if (err.Fail()) continue;
+
+    v8::HeapObject key_obj(key);
+    int64_t type = key_obj.GetType(err);
+    if (err.Fail()) continue;
+    if (type < v8->types()->kFirstNonstringType) {
+      v8::String name(key_obj);
+      if (!pending_.MayContain(name, err)) continue;
+    }
+
+    std::string name = key.ToString(err);
+    if (err.Fail() || !pending_.Contains(name)) continue;
+    names.names.push_back(name);
   }
+  return names;
+}
+
+
+void FindReferencesCmd::PropertyScanner::ScanFinished() {
+  // Property names nothing has are loaded too
+  for (const std::string& value : pending_.values())
+    llscan_->GetReferencesByProperty(value);
 }
 
 
 bool FindReferencesCmd::PropertyScanner::AreReferencesLoaded() {
-  return llscan_->AreReferencesByPropertyLoaded();
+  return pending_.empty();
 }
 
 
@@ -1075,149 +1314,430 @@ void FindReferencesCmd::StringScanner::PrintRefs(SBCommandReturnObject& result,
 }
 
 
-void FindReferencesCmd::StringScanner::ScanRefs(v8::JSObject& js_obj,
-                                                Error& err) {
-  v8::LLV8* v8 = js_obj.v8();
-  ReferencesVector* references;
-  std::set<std::string> already_saved;
-
-  int64_t length = js_obj.GetArrayLength(err);
-  for (int64_t i = 0; i < length; ++i) {
-    v8::Value v = js_obj.GetArrayElement(i, err);
-    if (err.Fail()) {
-      continue;
-    }
-    v8::HeapObject valueObj(v);
+FindReferencesCmd::StringScanner::StringScanner(
+    LLScan* llscan, const std::vector<std::string>& search_values)
+    : llscan_(llscan), search_values_(search_values) {
+  if (!search_values_.empty()) search_value_ = search_values_[0];
+}
 
-    int64_t type = valueObj.GetType(err);
-    if (err.Fail()) {
-      continue;
-    }
-    if (type < v8->types()->kFirstNonstringType) {
-      v8::String valueString(valueObj);
-      std::string value = valueString.ToString(err);
-      if (err.Fail()) {
-        continue;
-      }
 
-      if (already_saved.count(value)) continue;
+void FindReferencesCmd::StringSet::Insert(const std::string& value) {
+  values_.insert(value);
 
-      references = llscan_->GetReferencesByString(value);
-      references->push_back(js_obj.raw());
-      already_saved.insert(value);
-    }
+  // Strings are compared after conversion to UTF-8, but V8 counts their
+  // length in UTF-16 code units, or in bytes for one byte strings
+  int64_t utf16_length = 0;
+  for (unsigned char c : value) {
+    if ((c & 0xc0) != 0x80) utf16_length++;
+    if (c >= 0xf0) utf16_length++;
   }
+  lengths_.insert(value.size());
+  lengths_.insert(utf16_length);
+}
 
-  // Walk all the properties in this object.
-  // We only create strings for the field names that match the search
-  // value.
-  std::vector<std::pair<v8::Value, v8::Value>> entries = js_obj.Entries(err);
-  if (err.Success()) {
-    for (auto entry : entries) {
-      v8::HeapObject valueObj(entry.second);
-      int64_t type = valueObj.GetType(err);
-      if (err.Fail()) {
-        continue;
-      }
-      if (type < v8->types()->kFirstNonstringType) {
-        v8::String valueString(valueObj);
-        std::string value = valueString.ToString(err);
-        if (err.Fail()) {
-          continue;
-        }
-        if (already_saved.count(value)) continue;
 
-        references = llscan_->GetReferencesByString(value);
-        references->push_back(js_obj.raw());
-        already_saved.insert(value);
-      }
-    }
+bool FindReferencesCmd::StringSet::MayContain(v8::String& str,
+                                              Error& err) const {
+  int64_t length = str.Length(err).GetValue();
+  if (err.Fail()) return false;
+  return lengths_.count(length) != 0;
+}
+
+
+ReferencesVector* FindReferencesCmd::StringScanner::GetReferences() {
+  llscan_->LoadReferencesByValue();
+  llscan_->LoadStringIndex(false);
+
+  // Every string with the search value, several copies of it usually live
+  // in the heap
+  std::vector<uint64_t> strings;
+  llscan_->GetStringIndex().FindEqual(search_value_,
+                                      llscan_->GetStringContent(), strings);
+
+  ReferenceIndex& index = llscan_->GetReferencesByValue();
+  references_.clear();
+  for (uint64_t str : strings) {
+    ReferenceRange referrers = index.GetReferences(str);
+    references_.insert(references_.end(), referrers.begin(), referrers.end());
   }
+  std::sort(references_.begin(), references_.end());
+  references_.erase(std::unique(references_.begin(), references_.end()),
+                    references_.end());
+  return &references_;
 }
 
 
-void FindReferencesCmd::StringScanner::ScanRefs(v8::String& str, Error& err) {
-  v8::LLV8* v8 = str.v8();
-  ReferencesVector* references;
+bool RetainersCmd::DoExecute(SBDebugger d, char** cmd,
+                             SBCommandReturnObject& result) {
+  if (cmd == nullptr || *cmd == nullptr) {
+    result.SetError("USAGE: v8 retainers [-d depth] [-p paths] expr\n");
+    return false;
+  }
 
-  // Concatenated and sliced strings refer to other strings so
-  // we need to check their references.
+  SBTarget target = d.GetSelectedTarget();
+  if (!target.IsValid()) {
+    result.SetError("No valid process, please start something\n");
+    return false;
+  }
 
-  int64_t repr = str.Representation(err);
-  if (err.Fail()) return;
+  // Load V8 constants from postmortem data
+  llscan_->v8()->Load(target);
+  node_->Load(target);
+
+  uint32_t max_depth = 16;
+  uint32_t max_paths = 5;
+  bool bad_option = false;
+  char** start =
+      ParseRetainersOptions(cmd, &max_depth, &max_paths, &bad_option);
+  if (bad_option) {
+    result.SetError("Invalid option");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+  if (*start == nullptr) {
+    result.SetError("Missing search parameter");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
 
-  if (repr == v8->string()->kSlicedStringTag) {
-    v8::SlicedString sliced_str(str);
-    v8::String parent_str = sliced_str.Parent(err);
-    if (err.Fail()) return;
-    std::string parent = parent_str.ToString(err);
-    if (err.Success()) {
-      references = llscan_->GetReferencesByString(parent);
-      references->push_back(str.raw());
+  std::string full_cmd;
+  for (; start != nullptr && *start != nullptr; start++) full_cmd += *start;
+
+  SBExpressionOptions options;
+  SBValue value = target.EvaluateExpression(full_cmd.c_str(), options);
+  if (value.GetError().Fail()) {
+    SBStream desc;
+    if (value.GetError().GetDescription(desc)) {
+      result.SetError(desc.GetData());
     }
-  } else if (repr == v8->string()->kConsStringTag) {
-    v8::ConsString cons_str(str);
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
 
-    v8::String first_str = cons_str.First(err);
-    if (err.Fail()) return;
+  v8::Value search_value(llscan_->v8(), value.GetValueAsSigned());
+  v8::Smi smi(search_value);
+  if (smi.Check()) {
+    result.SetError("Search value is an SMI.");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
 
-    // It looks like sometimes one of the strings can be <null> or another
-    // value,
-    // verify that they are a JavaScript String before calling ToString.
-    int64_t first_type = first_str.GetType(err);
-    if (err.Fail()) return;
+  if (!llscan_->ScanHeapForObjects(target, result)) {
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
 
-    if (first_type < v8->types()->kFirstNonstringType) {
-      std::string first = first_str.ToString(err);
+  std::vector<RetainerPath> paths;
+  llscan_->FindRetainers(search_value.raw(), node_, max_depth, max_paths,
+                         paths);
+  if (paths.empty()) {
+    result.Printf("No retainer paths found within %" PRIu32 " references\n",
+                  max_depth);
+  }
 
-      if (err.Success()) {
-        references = llscan_->GetReferencesByString(first);
-        references->push_back(str.raw());
+  for (size_t i = 0; i < paths.size(); i++) {
+    const RetainerPath& path = paths[i];
+    result.Printf("Path %zu, %zu references, ends at %s:\n", i + 1,
+                  path.objects.size() - 1, path.root.c_str());
+
+    for (size_t j = 0; j < path.objects.size(); j++) {
+      Error err;
+      v8::HeapObject heap_object(llscan_->v8(), path.objects[j]);
+      std::string type_name = heap_object.GetTypeName(err);
+      if (v8::Context::IsContext(llscan_->v8(), heap_object, err))
+        type_name = "(Context)";
+
+      if (j == 0) {
+        result.Printf("  0x%016" PRIx64 " %s\n", path.objects[j],
+                      type_name.c_str());
+        continue;
       }
+
+      std::string name =
+          llscan_->GetReferenceName(path.objects[j], path.objects[j - 1]);
+      result.Printf("  <- 0x%016" PRIx64 " %s%s\n", path.objects[j],
+                    type_name.c_str(), name.c_str());
     }
+  }
 
-    v8::String second_str = cons_str.Second(err);
-    if (err.Fail()) return;
+  result.SetStatus(eReturnStatusSuccessFinishResult);
+  return true;
+}
 
-    // It looks like sometimes one of the strings can be <null> or another
-    // value,
-    // verify that they are a JavaScript String before calling ToString.
-    int64_t second_type = second_str.GetType(err);
-    if (err.Fail()) return;
 
-    if (second_type < v8->types()->kFirstNonstringType) {
-      std::string second = second_str.ToString(err);
+char** RetainersCmd::ParseRetainersOptions(char** cmd, uint32_t* max_depth,
+                                           uint32_t* max_paths,
+                                           bool* bad_option) {
+  static struct option opts[] = {{"depth", required_argument, nullptr, 'd'},
+                                 {"paths", required_argument, nullptr, 'p'},
+                                 {nullptr, 0, nullptr, 0}};
 
-      if (err.Success()) {
-        references = llscan_->GetReferencesByString(second);
-        references->push_back(str.raw());
-      }
+  int argc = 1;
+  for (char** p = cmd; p != nullptr && *p != nullptr; p++) argc++;
+
+  char* args[argc];
+
+  // Make this look like a command line, we need a valid element at index 0
+  // for getopt_long to use in its error messages.
+  char name[] = "llscan";
+  args[0] = name;
+  for (int i = 0; i < argc - 1; i++) args[i + 1] = cmd[i];
+
+  // Reset getopts.
+  optind = 0;
+  opterr = 1;
+  do {
+    int arg = getopt_long(argc, args, "d:p:", opts, nullptr);
+    if (arg == -1) break;
+
+    switch (arg) {
+      case 'd':
+        *max_depth = strtoul(optarg, nullptr, 10);
+        break;
+      case 'p':
+        *max_paths = strtoul(optarg, nullptr, 10);
+        break;
+      default:
+        *bad_option = true;
+        break;
+    }
+  } while (true);
+
+  return &cmd[optind - 1];
+}
+
+
+bool RetainedCmd::DoExecute(SBDebugger d, char** cmd,
+                            SBCommandReturnObject& result) {
+  if (cmd == nullptr || *cmd == nullptr) {
+    result.SetError("USAGE: v8 retained expr\n");
+    return false;
+  }
+
+  SBTarget target = d.GetSelectedTarget();
+  if (!target.IsValid()) {
+    result.SetError("No valid process, please start something\n");
+    return false;
+  }
+
+  // Load V8 constants from postmortem data
+  llscan_->v8()->Load(target);
+  node_->Load(target);
+
+  std::string full_cmd;
+  for (char** start = cmd; *start != nullptr; start++) full_cmd += *start;
+
+  SBExpressionOptions options;
+  SBValue value = target.EvaluateExpression(full_cmd.c_str(), options);
+  if (value.GetError().Fail()) {
+    SBStream desc;
+    if (value.GetError().GetDescription(desc)) {
+      result.SetError(desc.GetData());
     }
+    result.SetStatus(eReturnStatusFailed);
+    return false;
   }
-  // Nothing to do for other kinds of string.
-  // They are strings so we will find references to them.
+
+  v8::Value search_value(llscan_->v8(), value.GetValueAsSigned());
+  v8::Smi smi(search_value);
+  if (smi.Check()) {
+    result.SetError("Search value is an SMI.");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+
+  if (!llscan_->ScanHeapForObjects(target, result)) {
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+
+  if (!llscan_->LoadDominatorTree(node_)) {
+    result.SetError("The heap graph is too large to compute retained sizes");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+
+  DominatorTree& dominators = llscan_->GetDominatorTree();
+  int64_t node = dominators.Find(search_value.raw());
+  if (node == -1) {
+    result.SetError("Object isn't referenced by, nor references, any scanned "
+                    "object");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+
+  auto print_object = [&](const char* prefix, uint32_t n) {
+    Error err;
+    v8::HeapObject heap_object(llscan_->v8(), dominators.GetAddress(n));
+    std::string type_name = heap_object.GetTypeName(err);
+    if (v8::Context::IsContext(llscan_->v8(), heap_object, err))
+      type_name = "(Context)";
+    result.Printf("%s0x%016" PRIx64 " %s, retained size %" PRIu64 "\n", prefix,
+                  dominators.GetAddress(n), type_name.c_str(),
+                  dominators.GetRetainedSize(n));
+  };
+
+  std::vector<uint32_t> dominated;
+  dominators.GetDominated(node, dominated);
+  std::sort(dominated.begin(), dominated.end(), [&](uint32_t a, uint32_t b) {
+    return dominators.GetRetainedSize(a) > dominators.GetRetainedSize(b);
+  });
+
+  // Its own size is whatever its dominated objects don't account for
+  uint64_t shallow_size = dominators.GetRetainedSize(node);
+  for (uint32_t n : dominated) shallow_size -= dominators.GetRetainedSize(n);
+
+  print_object("", node);
+  result.Printf("Shallow size %" PRIu64 "\n", shallow_size);
+
+  int64_t dominator = dominators.GetDominator(node);
+  if (dominator == -1)
+    result.Printf("Only dominated by the roots\n");
+  else
+    print_object("Immediate dominator: ", dominator);
+
+  static const size_t kMaxDominated = 10;
+  if (!dominated.empty())
+    result.Printf("Dominates %zu objects, largest first:\n", dominated.size());
+  for (size_t i = 0; i < dominated.size() && i < kMaxDominated; i++)
+    print_object("  ", dominated[i]);
+
+  result.SetStatus(eReturnStatusSuccessFinishResult);
+  return true;
 }
 
 
-bool FindReferencesCmd::StringScanner::AreReferencesLoaded() {
-  return llscan_->AreReferencesByStringLoaded();
+bool FindStringsCmd::DoExecute(SBDebugger d, char** cmd,
+                               SBCommandReturnObject& result) {
+  MatchType type = MatchType::kEqual;
+  char** start = ParseFindStringsOptions(cmd, &type);
+  if (type == MatchType::kBadOption || start == nullptr || *start == nullptr) {
+    result.SetError("USAGE: v8 findstrings [-c | -p] text\n");
+    return false;
+  }
+
+  SBTarget target = d.GetSelectedTarget();
+  if (!target.IsValid()) {
+    result.SetError("No valid process, please start something\n");
+    return false;
+  }
+
+  // Load V8 constants from postmortem data
+  llscan_->v8()->Load(target);
+
+  // Every argument is a separate string, as for findrefs -s, so an extra
+  // parameter is text that needed quoting.
+  if (start[1] != nullptr) {
+    result.SetError("Extra search parameter or unquoted string specified.");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+  std::string text = start[0];
+
+  if (!llscan_->ScanHeapForObjects(target, result)) {
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+
+  if (!llscan_->LoadStringIndex(type != MatchType::kEqual)) {
+    result.SetError("Too many strings to index");
+    result.SetStatus(eReturnStatusFailed);
+    return false;
+  }
+
+  StringIndex& index = llscan_->GetStringIndex();
+  StringIndex::ContentFunction content = llscan_->GetStringContent();
+  std::vector<uint64_t> strings;
+  if (type == MatchType::kEqual) {
+    index.FindEqual(text, content, strings);
+  } else {
+    index.FindContaining(text, type == MatchType::kPrefix, content, strings);
+  }
+
+  v8::Value::InspectOptions inspect_options;
+  for (uint64_t address : strings) {
+    Error err;
+    v8::Value v8_value(llscan_->v8(), address);
+    std::string res = v8_value.Inspect(&inspect_options, err);
+    result.Printf("%s\n", res.c_str());
+  }
+  result.Printf("%zu strings found\n", strings.size());
+
+  result.SetStatus(eReturnStatusSuccessFinishResult);
+  return true;
 }
 
 
-ReferencesVector* FindReferencesCmd::StringScanner::GetReferences() {
-  return llscan_->GetReferencesByString(search_value_);
+char** FindStringsCmd::ParseFindStringsOptions(char** cmd, MatchType* type) {
+  static struct option opts[] = {{"contains", no_argument, nullptr, 'c'},
+                                 {"prefix", no_argument, nullptr, 'p'},
+                                 {nullptr, 0, nullptr, 0}};
+
+  int argc = 1;
+  for (char** p = cmd; p != nullptr && *p != nullptr; p++) argc++;
+
+  char* args[argc];
+
+  // Make this look like a command line, we need a valid element at index 0
+  // for getopt_long to use in its error messages.
+  char name[] = "llscan";
+  args[0] = name;
+  for (int i = 0; i < argc - 1; i++) args[i + 1] = cmd[i];
+
+  // Reset getopts.
+  optind = 0;
+  opterr = 1;
+  do {
+    int arg = getopt_long(argc, args, "cp", opts, nullptr);
+    if (arg == -1) break;
+
+    switch (arg) {
+      case 'c':
+        *type = MatchType::kContains;
+        break;
+      case 'p':
+        *type = MatchType::kPrefix;
+        break;
+      default:
+        *type = MatchType::kBadOption;
+        break;
+    }
+  } while (true);
+
+  if (cmd == nullptr) return nullptr;
+  return &cmd[optind - 1];
 }
 
 
-FindJSObjectsVisitor::FindJSObjectsVisitor(SBTarget& target, LLScan* llscan)
-    : target_(target), llscan_(llscan) {
+FindJSObjectsVisitor::FindJSObjectsVisitor(SBTarget& target, LLScan* llscan,
+                                           Shard* shard)
+    : target_(target), llscan_(llscan), shard_(shard) {
   found_count_ = 0;
   address_byte_size_ = target_.GetProcess().GetAddressByteSize();
+
+  const char* heap_walk = getenv("LLNODE_HEAP_WALK");
+  heap_walk_ = heap_walk != nullptr && strcmp(heap_walk, "true") == 0;
+
+  if (shard_ != nullptr) {
+    maps_to_instances_ = &shard_->maps_to_instances;
+    detailed_maps_to_instances_ = &shard_->detailed_maps_to_instances;
+    contexts_ = &shard_->contexts;
+    objects_ = &shard_->objects;
+    skips_ = &shard_->skips;
+  } else {
+    maps_to_instances_ = &llscan_->GetMapsToInstances();
+    detailed_maps_to_instances_ = &llscan_->GetDetailedMapsToInstances();
+    contexts_ = llscan_->GetContexts();
+    objects_ = &llscan_->GetObjectTable();
+    skips_ = &llscan_->GetHeapWalkSkips();
+  }
 }
 
 
 /* Visit every address, a bit brute force but it works. */
 uint64_t FindJSObjectsVisitor::Visit(uint64_t location, uint64_t word) {
+  if (heap_walk_) return VisitObjectStart(location, word);
+
   v8::Value v8_value(llscan_->v8(), word);
 
   Error err;
@@ -1233,69 +1753,121 @@ uint64_t FindJSObjectsVisitor::Visit(uint64_t location, uint64_t word) {
   if (err.Fail() || !map_object.Check()) return address_byte_size_;
 
   v8::Map map(map_object);
+  RecordObject(word, heap_object, map);
 
-  MapCacheEntry map_info;
-  if (map_cache_.count(map.raw()) == 0) {
-    map_info.Load(map, heap_object, llscan_->v8(), err);
-    if (err.Fail()) {
-      return address_byte_size_;
-    }
-    // Cache result
-    map_cache_.emplace(map.raw(), map_info);
-  } else {
-    map_info = map_cache_.at(map.raw());
-  }
+  /* Just advance one word.
+   * (Should advance by object size, assuming objects can't overlap!)
+   */
+  return address_byte_size_;
+}
 
-  if (map_info.is_context) {
-    InsertOnContexts(word, err);
-    return address_byte_size_;
-  }
 
-  if (!map_info.is_histogram) return address_byte_size_;
+/* Heap walk mode: only accept an object if `location` is its start, i.e.
+ * `word` is a pointer to a Map, and then skip the whole object. Returns a
+ * single word if no object starts here, and skips to the next page if the
+ * object's size can't be determined, counting the bytes skipped.
+ */
+uint64_t FindJSObjectsVisitor::VisitObjectStart(uint64_t location,
+                                                uint64_t word) {
+  v8::LLV8* v8 = llscan_->v8();
 
-  InsertOnMapsToInstances(word, map, map_info, err);
-  InsertOnDetailedMapsToInstances(word, map, map_info, err);
+  Error err;
+  v8::HeapObject map_object(v8, word);
+  if (!map_object.Check()) return address_byte_size_;
 
-  if (err.Fail()) {
+  int64_t map_type = map_object.GetType(err);
+  if (err.Fail() || map_type != v8->types()->kMapType)
     return address_byte_size_;
+
+  uint64_t object = location + v8->heap_obj()->kTag;
+  v8::HeapObject heap_object(v8, object);
+  v8::Map map(map_object);
+  RecordObject(object, heap_object, map);
+
+  int64_t size = heap_object.Size(err);
+  if (!err.Fail()) return static_cast<uint64_t>(size);
+
+  // Without the size the next object start is unknown, and stepping word by
+  // word would take the map pointers in this object's body for objects.
+  // Resume at the next page instead.
+  uint64_t alignment = static_cast<uint64_t>(v8::MemoryChunk::Alignment(v8));
+  uint64_t skipped = alignment - location % alignment;
+  skips_->bytes += skipped;
+  Error type_err;
+  int64_t type = heap_object.GetType(type_err);
+  if (type_err.Success()) skips_->types.insert(type);
+  return skipped;
+}
+
+
+void FindJSObjectsVisitor::RecordObject(uint64_t word,
+                                        v8::HeapObject heap_object,
+                                        v8::Map map) {
+  Error err;
+  MapCacheEntry* map_info = LoadMapCacheEntry(map, heap_object);
+  if (map_info == nullptr) return;
+
+  if (map_info->is_context) {
+    InsertOnContexts(word, err);
+    return;
   }
 
+  if (!map_info->is_histogram) return;
+
+  objects_->AddObject(word, map_info->map_id);
+
   found_count_++;
+}
 
-  /* Just advance one word.
-   * (Should advance by object size, assuming objects can't overlap!)
-   */
-  return address_byte_size_;
+
+/* Returns the cached information about `map`, loading it on first sight.
+ * Returns nullptr if the map couldn't be loaded.
+ */
+FindJSObjectsVisitor::MapCacheEntry* FindJSObjectsVisitor::LoadMapCacheEntry(
+    v8::Map map, v8::HeapObject heap_object) {
+  uint32_t* index = map_cache_.Find(map.raw());
+  if (index != nullptr) return &map_entries_[*index];
+
+  Error err;
+  MapCacheEntry map_info;
+  map_info.Load(map, heap_object, llscan_->v8(), err);
+  if (err.Fail()) return nullptr;
+
+  if (map_info.is_histogram) {
+    int64_t instance_size = map.InstanceSize(err);
+    if (err.Fail()) instance_size = 0;
+    map_info.map_id = objects_->AddMap(
+        map.raw(), GetTypeRecord(map_info), GetDetailedTypeRecord(map_info),
+        static_cast<uint64_t>(instance_size));
+  }
+
+  // Cache result
+  map_cache_.Insert(map.raw(), map_entries_.size());
+  map_entries_.push_back(std::move(map_info));
+  return &map_entries_.back();
 }
 
+
 void FindJSObjectsVisitor::InsertOnContexts(uint64_t word, Error& err) {
-  ContextVector* contexts;
-  contexts = llscan_->GetContexts();
-  contexts->insert(word);
+  contexts_->insert(word);
 }
 
-void FindJSObjectsVisitor::InsertOnMapsToInstances(
-    uint64_t word, v8::Map map, FindJSObjectsVisitor::MapCacheEntry map_info,
-    Error& err) {
-  TypeRecord* t;
 
+TypeRecord* FindJSObjectsVisitor::GetTypeRecord(MapCacheEntry& map_info) {
   auto entry = std::make_pair(map_info.type_name, nullptr);
-  auto pp = &llscan_->GetMapsToInstances().insert(entry).first->second;
+  auto pp = &maps_to_instances_->insert(entry).first->second;
   // No entry in the map, create a new one.
   if (*pp == nullptr) *pp = new TypeRecord(map_info.type_name);
-  t = *pp;
-  t->AddInstance(word, map.InstanceSize(err));
+  return *pp;
 }
 
-void FindJSObjectsVisitor::InsertOnDetailedMapsToInstances(
-    uint64_t word, v8::Map map, FindJSObjectsVisitor::MapCacheEntry map_info,
-    Error& err) {
-  DetailedTypeRecord* t;
 
+DetailedTypeRecord* FindJSObjectsVisitor::GetDetailedTypeRecord(
+    MapCacheEntry& map_info) {
   auto type_name_with_properties = map_info.GetTypeNameWithProperties();
 
   auto entry = std::make_pair(type_name_with_properties, nullptr);
-  auto pp = &llscan_->GetDetailedMapsToInstances().insert(entry).first->second;
+  auto pp = &detailed_maps_to_instances_->insert(entry).first->second;
   // No entry in the map, create a new one.
   if (*pp == nullptr) {
     auto type_name_with_three_properties = map_info.GetTypeNameWithProperties(
@@ -1305,8 +1877,7 @@ void FindJSObjectsVisitor::InsertOnDetailedMapsToInstances(
                                  map_info.own_descriptors_count_,
                                  map_info.indexed_properties_count_);
   }
-  t = *pp;
-  t->AddInstance(word, map.InstanceSize(err));
+  return *pp;
 }
 
 
@@ -1343,6 +1914,12 @@ bool LLScan::ScanHeapForObjects(lldb::SBTarget target,
     target_ = target;
   }
 
+  /* Prefer the segments of the mapped core file, they are known without any
+   * round trip through LLDB. */
+  if (nullptr == ranges_ && llv8_->core().IsOpen()) {
+    GenerateMemoryRangesFromCore();
+  }
+
 #ifndef LLDB_SBMemoryRegionInfoList_h_
   /* Fall back to environment variable containing pre-parsed list of memory
    * ranges. */
@@ -1353,7 +1930,8 @@ bool LLScan::ScanHeapForObjects(lldb::SBTarget target,
       result.SetError(
           "No memory range information available for this process. Cannot scan "
           "for objects.\n"
-          "Please set `LLNODE_RANGESFILE` environment variable\n");
+          "Please set `LLNODE_COREFILE` or `LLNODE_RANGESFILE` environment "
+          "variable\n");
       return false;
     }
 
@@ -1370,11 +1948,32 @@ bool LLScan::ScanHeapForObjects(lldb::SBTarget target,
    * ranges in the process and can scan for objects.
    */
 
-  /* Populate the map of objects. */
-  if (mapstoinstances_.empty()) {
+  /* Populate the map of objects, from a previous session if possible. */
+  if (mapstoinstances_.empty() && !LoadScanIndex()) {
     FindJSObjectsVisitor v(target, this);
 
     ScanMemoryRanges(v, scan);
+
+    std::vector<TypeRecord*> records;
+    for (auto entry : mapstoinstances_) records.push_back(entry.second);
+    std::vector<DetailedTypeRecord*> detailed_records;
+    for (auto entry : detailedmapstoinstances_)
+      detailed_records.push_back(entry.second);
+    objects_.Finalize(records, detailed_records);
+
+    if (!pages_.empty()) ComputeSpaceStatistics();
+
+    if (heap_walk_skips_.bytes != 0) {
+      std::string types;
+      for (int64_t type : heap_walk_skips_.types)
+        types += (types.empty() ? "" : ", ") + std::to_string(type);
+      result.Printf(
+          "Heap walk skipped %" PRIu64
+          " bytes after objects of unknown size, instance types: %s\n",
+          heap_walk_skips_.bytes, types.c_str());
+    }
+
+    SaveScanIndex();
   }
 
   return true;
@@ -1424,6 +2023,8 @@ bool FindJSObjectsVisitor::MapCacheEntry::Load(v8::Map map,
   v8::DescriptorArray descriptors(descriptors_obj);
   own_descriptors_count_ = map.NumberOfOwnDescriptors(err);
   if (err.Fail()) return false;
+  v8::FieldSnapshot descriptor_fields =
+      descriptors.Snapshot(own_descriptors_count_);
 
   int64_t type = map.GetType(err);
   indexed_properties_count_ = 0;
@@ -1435,7 +2036,7 @@ bool FindJSObjectsVisitor::MapCacheEntry::Load(v8::Map map,
   }
 
   for (uint64_t i = 0; i < own_descriptors_count_; i++) {
-    v8::Value key = descriptors.GetKey(i, err);
+    v8::Value key = descriptors.GetKey(descriptor_fields, i, err);
     if (err.Fail()) continue;
     properties_.emplace_back(key.ToString(err));
   }
@@ -1453,89 +2054,774 @@ inline static ByteOrder GetHostByteOrder() {
 }
 
 void LLScan::ScanMemoryRanges(FindJSObjectsVisitor& v, HeapScanMonitor* scan) {
-  bool done = false;
+  // Cached so the workers of a parallel scan don't need to ask LLDB
+  addr_size_ = process_.GetAddressByteSize();
+  swap_bytes_ = process_.GetByteOrder() != GetHostByteOrder();
 
-  const uint64_t addr_size = process_.GetAddressByteSize();
-  bool swap_bytes = process_.GetByteOrder() != GetHostByteOrder();
+  std::vector<MemoryRange> ranges;
+  for (MemoryRange* head = ranges_; head != nullptr; head = head->next_) {
+    ranges.push_back(*head);
+  }
 
-  // Pages are usually around 1mb, so this should more than enough
-  const uint64_t block_size = 1024 * 1024 * addr_size;
-  unsigned char* block = new unsigned char[block_size];
+#ifdef LLDB_SBMemoryRegionInfoList_h_
+  if (ranges.empty()) {
+    lldb::SBMemoryRegionInfoList memory_regions = process_.GetMemoryRegions();
+    lldb::SBMemoryRegionInfo region_info;
 
-#ifndef LLDB_SBMemoryRegionInfoList_h_
-  MemoryRange* head = ranges_;
+    for (uint32_t i = 0; i < memory_regions.GetSize(); ++i) {
+      memory_regions.GetMemoryRegionAtIndex(i, region_info);
 
-  while (head != nullptr && !done) {
-    uint64_t address = head->start_;
-    uint64_t len = head->length_;
-    head = head->next_;
+      if (!region_info.IsWritable()) {
+        continue;
+      }
+
+      ranges.emplace_back(
+          region_info.GetRegionBase(),
+          region_info.GetRegionEnd() - region_info.GetRegionBase());
+    }
+  }
+#endif  // LLDB_SBMemoryRegionInfoList_h_
+
+  /* Restrict the scan to the object area of V8's heap pages, if they can be
+   * found. */
+  const char* scan_pages = getenv("LLNODE_SCAN_PAGES");
+  if (scan_pages != nullptr && strcmp(scan_pages, "true") == 0 &&
+      FindHeapPages(ranges)) {
+    ranges.clear();
+    for (const HeapPage& page : pages_) {
+      ranges.emplace_back(page.start, page.end - page.start);
+    }
+  }
 
-#else  // LLDB_SBMemoryRegionInfoList_h_
-  lldb::SBMemoryRegionInfoList memory_regions = process_.GetMemoryRegions();
-  lldb::SBMemoryRegionInfo region_info;
+  /* Workers only read the mapped core and memory LLV8 serializes, going
+   * through LLDB from several threads at once isn't safe. */
+  uint32_t threads = GetScanThreadCount();
+  if (threads > 1 && llv8_->core().IsOpen()) {
+    ScanMemoryRangesParallel(ranges, threads, scan);
+    return;
+  }
 
-  uint32_t size = memory_regions.GetSize();
+  // Pages are usually around 1mb, so this should more than enough
+  unsigned char* block = new unsigned char[1024 * 1024 * addr_size_];
+
+  uint32_t size = ranges.size();
   for (uint32_t i = 0; i < size; ++i) {
     if (scan != nullptr) scan(llnode_, i, size);
-    memory_regions.GetMemoryRegionAtIndex(i, region_info);
 
-    if (!region_info.IsWritable()) {
-      continue;
-    }
+    if (!ScanMemoryRange(v, ranges[i].start_, ranges[i].length_, block)) break;
+  }
 
-    uint64_t address = region_info.GetRegionBase();
-    uint64_t len = region_info.GetRegionEnd() - region_info.GetRegionBase();
+  delete[] block;
+}
 
-#endif  // LLDB_SBMemoryRegionInfoList_h_
-    /* Brute force search - query every address - but allow the visitor code to
-     * say how far to move on so we don't read every byte.
-     */
 
-    SBError sberr;
-    uint64_t address_end = address + len;
+/* Scan [address, address + len) with `v`, using `block` (1mb words) as
+ * buffer for memory that isn't in the mapped core. Returns false if the
+ * visitor asked to stop.
+ */
+bool LLScan::ScanMemoryRange(FindJSObjectsVisitor& v, uint64_t address,
+                             uint64_t len, unsigned char* block) {
+  const uint64_t addr_size = addr_size_;
+  const bool swap_bytes = swap_bytes_;
+  const CoreMemoryReader& core = llv8_->core();
+  const uint64_t block_size = 1024 * 1024 * addr_size;
+
+  /* Brute force search - query every address - but allow the visitor code to
+   * say how far to move on so we don't read every byte.
+   */
+
+  uint64_t address_end = address + len;
+  size_t skip = 0;
 
-    // Load data in blocks to speed up whole process
-    for (auto searchAddress = address; searchAddress < address_end;
-         searchAddress += block_size) {
-      size_t loaded = std::min(address_end - searchAddress, block_size);
-      process_.ReadMemory(searchAddress, block, loaded, sberr);
-      if (sberr.Fail()) {
+  // Load data in blocks to speed up whole process
+  for (auto searchAddress = address; searchAddress < address_end;
+       searchAddress += block_size) {
+    size_t loaded = std::min(address_end - searchAddress, block_size);
+
+    // Read the words in place when the core file is mapped
+    const unsigned char* data = core.GetPointer(searchAddress, loaded);
+    if (data == nullptr) {
+      // Goes through LLV8 so that worker threads don't share SBProcess
+      if (!llv8_->ReadMemory(searchAddress, block, loaded)) {
         // TODO(indutny): add error information
         break;
       }
+      data = block;
+    }
 
-      uint32_t increment = 1;
-      for (size_t j = 0; j + addr_size <= loaded;) {
-        uint64_t value;
+    uint64_t increment = 1;
+    size_t j = skip;
+    for (; j + addr_size <= loaded;) {
+      uint64_t value;
 
-        if (addr_size == 4) {
-          value = *reinterpret_cast<uint32_t*>(&block[j]);
-          if (swap_bytes) {
-            value = __builtin_bswap32(value);
-          }
-        } else if (addr_size == 8) {
-          value = *reinterpret_cast<uint64_t*>(&block[j]);
-          if (swap_bytes) {
-            value = __builtin_bswap64(value);
-          }
-        } else {
-          break;
+      if (addr_size == 4) {
+        value = *reinterpret_cast<const uint32_t*>(&data[j]);
+        if (swap_bytes) {
+          value = __builtin_bswap32(value);
         }
+      } else if (addr_size == 8) {
+        value = *reinterpret_cast<const uint64_t*>(&data[j]);
+        if (swap_bytes) {
+          value = __builtin_bswap64(value);
+        }
+      } else {
+        break;
+      }
 
-        increment = v.Visit(j + searchAddress, value);
-        if (increment == 0) break;
+      increment = v.Visit(j + searchAddress, value);
+      if (increment == 0) break;
+
+      j += static_cast<size_t>(increment);
+    }
 
-        j += static_cast<size_t>(increment);
+    if (increment == 0) return false;
+
+    // Objects can span blocks, continue after the last one visited
+    skip = j > loaded ? j - loaded : 0;
+  }
+
+  return true;
+}
+
+
+/* Find the V8 heap pages within `ranges` by probing every page aligned
+ * address for a plausible MemoryChunk header, and record the object area and
+ * space of each of them. Returns false if none was found, e.g. when the
+ * header layout doesn't match this V8 version.
+ */
+bool LLScan::FindHeapPages(const std::vector<MemoryRange>& ranges) {
+  pages_.clear();
+
+  int64_t alignment = v8::MemoryChunk::Alignment(llv8_);
+  for (const MemoryRange& range : ranges) {
+    int64_t end = range.start_ + range.length_;
+    int64_t address = (range.start_ + alignment - 1) & ~(alignment - 1);
+
+    while (address + alignment <= end) {
+      Error err;
+      v8::MemoryChunk chunk(llv8_, address);
+      if (!chunk.Check(end, err)) {
+        address += alignment;
+        continue;
       }
 
-      if (increment == 0) {
-        done = true;
-        break;
+      HeapPage page;
+      page.start = chunk.AreaStart(err);
+      page.end = chunk.AreaEnd(err);
+      page.space = chunk.GetSpace(err);
+      pages_.push_back(page);
+
+      int64_t size = chunk.Size(err);
+      address = (address + size + alignment - 1) & ~(alignment - 1);
+    }
+  }
+
+  std::sort(pages_.begin(), pages_.end(),
+            [](const HeapPage& a, const HeapPage& b) {
+              return a.start < b.start;
+            });
+
+  Error::PrintInDebugMode("Found %zu V8 heap pages", pages_.size());
+  return !pages_.empty();
+}
+
+
+v8::MemoryChunk::Space LLScan::GetSpace(uint64_t address) {
+  auto it = std::upper_bound(
+      pages_.begin(), pages_.end(), address,
+      [](uint64_t a, const HeapPage& page) { return a < page.start; });
+  if (it == pages_.begin()) return v8::MemoryChunk::kUnknownSpace;
+  --it;
+
+  if (address >= it->end) return v8::MemoryChunk::kUnknownSpace;
+  return it->space;
+}
+
+
+void LLScan::ComputeSpaceStatistics() {
+  for (SpaceStatistics& statistics : space_statistics_) {
+    statistics = SpaceStatistics();
+  }
+
+  for (uint32_t row = 0; row < objects_.size(); row++) {
+    uint64_t address = objects_.GetAddress(row);
+    Error err;
+    v8::HeapObject object(llv8_, address);
+    int64_t size = object.Size(err);
+
+    SpaceStatistics& statistics = space_statistics_[GetSpace(address)];
+    statistics.count++;
+    if (err.Success()) statistics.size += size;
+  }
+}
+
+
+void LLScan::FinishReferencesByValue() {
+  references_by_value_.Build();
+  SaveScanIndex();
+}
+
+
+void LLScan::LoadReferencesByValue() {
+  if (AreReferencesByValueLoaded()) return;
+
+  FindReferencesCmd cmd(this);
+  FindReferencesCmd::ReferenceScanner scanner(this, v8::Value(llv8_, 0));
+  cmd.ScanForReferences(&scanner);
+}
+
+
+/* Root candidates are the global objects, native contexts and `process`
+ * objects, as well as the JavaScript objects of the active handles and
+ * requests of `node`'s current Environment.
+ */
+void LLScan::FindRetainers(uint64_t address, node::Node* node,
+                           uint32_t max_depth, uint32_t max_paths,
+                           std::vector<RetainerPath>& paths) {
+  LoadReferencesByValue();
+
+  std::unordered_set<uint64_t> handles;
+  FindHandleObjects(node, handles);
+  RootPredicate is_root = [&](uint64_t object, std::string& reason) {
+    return IsRootCandidate(object, handles, reason);
+  };
+
+  FindRetainerPaths(references_by_value_, address, is_root, max_depth,
+                    max_paths, paths);
+}
+
+
+/* JavaScript objects of the active handles and requests of `node`'s current
+ * Environment, if any.
+ */
+void LLScan::FindHandleObjects(node::Node* node,
+                               std::unordered_set<uint64_t>& handles) {
+  Error err;
+  node::Environment env = node::Environment::GetCurrent(node, err);
+  if (err.Fail()) return;
+
+  for (auto w : env.handle_wrap_queue()) {
+    if (w.Persistent(err) == 0 || err.Fail()) continue;
+    handles.insert(w.Object(err));
+  }
+  for (auto w : env.req_wrap_queue()) {
+    if (w.Persistent(err) == 0 || err.Fail()) continue;
+    handles.insert(w.Object(err));
+  }
+}
+
+
+bool LLScan::IsRootCandidate(uint64_t object,
+                             const std::unordered_set<uint64_t>& handles,
+                             std::string& reason) {
+  if (handles.count(object) != 0) {
+    reason = "an active handle or request";
+    return true;
+  }
+
+  Error err;
+  v8::HeapObject heap_object(llv8_, object);
+  if (!heap_object.Check()) return false;
+
+  int64_t type = heap_object.GetType(err);
+  if (err.Fail()) return false;
+
+  if (type == llv8_->types()->kGlobalObjectType) {
+    reason = "a global object";
+    return true;
+  }
+  if (type == llv8_->types()->kGlobalProxyType) {
+    reason = "a global proxy";
+    return true;
+  }
+  if (v8::Context::IsContext(llv8_, heap_object, err)) {
+    v8::Context context(heap_object);
+    if (!context.IsNative(err)) return false;
+    reason = "a native context";
+    return true;
+  }
+
+  int64_t row = objects_.Find(object);
+  if (row != -1 && objects_.GetTypeRecord(row)->GetTypeName() == "process") {
+    reason = "a process object";
+    return true;
+  }
+  return false;
+}
+
+
+/* Dominator tree of everything the references by value know about, with
+ * the same root candidates as FindRetainers().
+ */
+bool LLScan::LoadDominatorTree(node::Node* node) {
+  if (dominators_.IsBuilt()) return true;
+  LoadReferencesByValue();
+
+  std::unordered_set<uint64_t> handles;
+  FindHandleObjects(node, handles);
+  RootPredicate is_root = [&](uint64_t object, std::string& reason) {
+    return IsRootCandidate(object, handles, reason);
+  };
+  DominatorTree::ObjectPredicate is_object = [&](uint64_t value) {
+    return v8::HeapObject(llv8_, value).Check();
+  };
+
+  // Objects of the table use the size of their map, like findjsobjects,
+  // unless it depends on their contents
+  DominatorTree::SizeFunction size = [&](uint64_t object) -> uint64_t {
+    int64_t row = objects_.Find(object);
+    if (row != -1 && objects_.GetSize(row) != 0) return objects_.GetSize(row);
+
+    Error err;
+    int64_t object_size = v8::HeapObject(llv8_, object).Size(err);
+    if (err.Fail() || object_size < 0) return 0;
+    return static_cast<uint64_t>(object_size);
+  };
+
+  return dominators_.Build(references_by_value_, is_object, is_root, size);
+}
+
+
+/* Retained size of every type, or detailed type, of the object table. */
+void LLScan::GetTypeRetainedSizes(bool detailed, RetainedSizeMap& sizes) {
+  sizes.clear();
+  if (!dominators_.IsBuilt()) return;
+
+  std::vector<TypeRecord*> records;
+  if (detailed) {
+    for (auto entry : detailedmapstoinstances_)
+      records.push_back(entry.second);
+  } else {
+    for (auto entry : mapstoinstances_) records.push_back(entry.second);
+  }
+
+  std::unordered_map<TypeRecord*, uint32_t> ids;
+  for (uint32_t i = 0; i < records.size(); i++) ids[records[i]] = i;
+
+  DominatorTree::GroupFunction group = [&](uint64_t object) -> uint32_t {
+    int64_t row = objects_.Find(object);
+    if (row == -1) return DominatorTree::kNoGroup;
+
+    TypeRecord* record = detailed ? objects_.GetDetailedTypeRecord(row)
+                                  : objects_.GetTypeRecord(row);
+    auto it = ids.find(record);
+    if (it == ids.end()) return DominatorTree::kNoGroup;
+    return it->second;
+  };
+
+  std::vector<uint64_t> group_sizes;
+  dominators_.GetGroupRetainedSizes(group, records.size(), group_sizes);
+  for (uint32_t i = 0; i < records.size(); i++)
+    sizes[records[i]] = group_sizes[i];
+}
+
+
+/* Index the contents of the strings of the object table, and with `grams`
+ * their trigrams too. An index without trigrams is built again if they are
+ * needed. Saved with the scan index, like the references.
+ */
+bool LLScan::LoadStringIndex(bool grams) {
+  // Trigrams that didn't fit once won't fit again
+  if (string_index_.IsBuilt() &&
+      (string_index_.HasGrams() || string_index_.HasTooManyGrams() || !grams))
+    return true;
+
+  std::vector<uint64_t> strings;
+  AddressMap<bool> map_is_string;
+  for (uint32_t row = 0; row < objects_.size(); row++) {
+    uint64_t map = objects_.GetMap(row);
+    bool* cached = map_is_string.Find(map);
+    bool is_string;
+    if (cached != nullptr) {
+      is_string = *cached;
+    } else {
+      Error err;
+      int64_t type = v8::Map(llv8_, map).GetType(err);
+      is_string = err.Success() && type < llv8_->types()->kFirstNonstringType;
+      map_is_string.Insert(map, is_string);
+    }
+    if (is_string) strings.push_back(objects_.GetAddress(row));
+  }
+
+  string_index_.Build(strings, GetStringContent(), grams);
+  if (!string_index_.IsBuilt()) return false;
+
+  SaveScanIndex();
+  return true;
+}
+
+
+StringIndex::ContentFunction LLScan::GetStringContent() {
+  v8::LLV8* v8 = llv8_;
+  return [v8](uint64_t address, std::string& value) {
+    Error err;
+    value = v8::String(v8, address).ToString(err);
+    return err.Success();
+  };
+}
+
+
+/* How `source` references `target`, e.g. ".name" or "[3]". Empty if the
+ * reference can't be found again.
+ */
+std::string LLScan::GetReferenceName(uint64_t source, uint64_t target) {
+  Error err;
+  v8::HeapObject heap_object(llv8_, source);
+  int64_t type = heap_object.GetType(err);
+  if (err.Fail()) return std::string();
+
+  if (v8::Context::IsContext(llv8_, heap_object, err)) {
+    v8::Context c(heap_object);
+    v8::Value previous = c.Previous(err);
+    if (err.Success() && previous.raw() == target) return ".<Previous>";
+
+    v8::Context::Locals locals(&c, err);
+    if (err.Fail()) return std::string();
+
+    for (v8::Context::Locals::Iterator it = locals.begin(); it != locals.end();
+         it++) {
+      if ((*it).raw() != target) continue;
+      v8::String name = it.LocalName(err);
+      if (err.Fail()) return std::string();
+      return "." + name.ToString(err);
+    }
+    return std::string();
+  }
+
+  if (v8::JSObject::IsObjectType(llv8_, type) ||
+      type == llv8_->types()->kJSArrayType) {
+    v8::JSObject js_obj(heap_object);
+    int64_t length = js_obj.GetArrayLength(err);
+    for (int64_t i = 0; i < length; ++i) {
+      v8::Value v = js_obj.GetArrayElement(i, err);
+      if (err.Fail()) break;
+      if (v.raw() == target) return "[" + std::to_string(i) + "]";
+    }
+
+    Error entries_err;
+    std::vector<std::pair<v8::Value, v8::Value>> entries =
+        js_obj.Entries(entries_err);
+    if (entries_err.Fail()) return std::string();
+    for (auto entry : entries) {
+      if (entry.second.raw() == target)
+        return "." + entry.first.ToString(entries_err);
+    }
+    return std::string();
+  }
+
+  if (type < llv8_->types()->kFirstNonstringType) {
+    v8::String str(heap_object);
+    int64_t repr = str.Representation(err);
+    if (err.Fail()) return std::string();
+
+    if (repr == llv8_->string()->kSlicedStringTag) return ".<Parent>";
+    if (repr == llv8_->string()->kThinStringTag) return ".<Actual>";
+    if (repr == llv8_->string()->kConsStringTag) {
+      v8::ConsString cons_str(str);
+      v8::String first = cons_str.First(err);
+      if (err.Success() && first.raw() == target) return ".<First>";
+      return ".<Second>";
+    }
+  }
+
+  return std::string();
+}
+
+
+/* Path of the scan index of the current core, or an empty string if scan
+ * indexes are disabled. Indexes are enabled by LLNODE_SCAN_INDEX and need
+ * the core file to be mapped, as they are keyed by the file itself.
+ */
+std::string LLScan::GetScanIndexPath() {
+  const char* scan_index = getenv("LLNODE_SCAN_INDEX");
+  if (scan_index == nullptr || strcmp(scan_index, "true") != 0)
+    return std::string();
+  if (!llv8_->core().IsOpen()) return std::string();
+
+  return llv8_->core().path() + ".llnode-index";
+}
+
+
+bool LLScan::LoadScanIndexKey(ScanIndexKey& key) {
+  Error err;
+  if (!key.Load(llv8_->core().path(), err)) return false;
+
+  // The executable is always the first module of a target
+  const char* build_id = target_.GetModuleAtIndex(0).GetUUIDString();
+  if (build_id != nullptr) key.build_id = build_id;
+
+  // Options that change which objects a scan finds
+  const char* heap_walk = getenv("LLNODE_HEAP_WALK");
+  if (heap_walk != nullptr && strcmp(heap_walk, "true") == 0)
+    key.options |= 1 << 0;
+  const char* scan_pages = getenv("LLNODE_SCAN_PAGES");
+  if (scan_pages != nullptr && strcmp(scan_pages, "true") == 0)
+    key.options |= 1 << 1;
+  return true;
+}
+
+
+/* Store the results of the last scan next to the core, so later sessions
+ * on the same core don't have to scan it again. Failures are only reported
+ * in debug mode, the index is just a cache.
+ */
+void LLScan::SaveScanIndex() {
+  std::string path = GetScanIndexPath();
+  if (path.empty()) return;
+
+  ScanIndexKey key;
+  if (!LoadScanIndexKey(key)) return;
+
+  Error err;
+  ScanIndexWriter writer;
+  if (!writer.Open(path, key, err)) return;
+
+  writer.WriteU64(mapstoinstances_.size());
+  for (auto entry : mapstoinstances_) writer.WriteString(entry.first);
+
+  writer.WriteU64(detailedmapstoinstances_.size());
+  for (auto entry : detailedmapstoinstances_) {
+    DetailedTypeRecord* t = entry.second;
+    writer.WriteString(entry.first);
+    writer.WriteString(t->GetTypeName());
+    writer.WriteU64(t->GetOwnDescriptorsCount());
+    writer.WriteU64(t->GetIndexedPropertiesCount());
+  }
+
+  objects_.Save(writer);
+
+  std::vector<uint64_t> contexts(contexts_.begin(), contexts_.end());
+  writer.WriteArray(contexts);
+
+  writer.WriteU64(pages_.size());
+  for (const HeapPage& page : pages_) {
+    writer.WriteU64(page.start);
+    writer.WriteU64(page.end);
+    writer.WriteU64(page.space);
+  }
+  for (const SpaceStatistics& statistics : space_statistics_) {
+    writer.WriteU64(statistics.count);
+    writer.WriteU64(statistics.size);
+  }
+
+  // References are only known after the first findrefs, which saves the
+  // index again
+  writer.WriteU64(references_by_value_.IsBuilt());
+  if (references_by_value_.IsBuilt()) references_by_value_.Save(writer);
+
+  // Same for the string index, built by the first string search
+  writer.WriteU64(string_index_.IsBuilt());
+  if (string_index_.IsBuilt()) string_index_.Save(writer);
+
+  if (writer.Commit(err))
+    Error::PrintInDebugMode("Saved scan index '%s'", path.c_str());
+}
+
+
+/* Load the results of a previous scan of the same core, written by
+ * SaveScanIndex(). Returns false, leaving no results behind, if there is
+ * no usable index.
+ */
+bool LLScan::LoadScanIndex() {
+  std::string path = GetScanIndexPath();
+  if (path.empty()) return false;
+
+  ScanIndexKey key;
+  if (!LoadScanIndexKey(key)) return false;
+
+  Error err;
+  ScanIndexReader reader;
+  if (!reader.Open(path, key, err)) return false;
+
+  bool valid = true;
+
+  std::vector<TypeRecord*> records;
+  uint64_t count = reader.ReadU64();
+  for (uint64_t i = 0; i < count && valid && !reader.failed(); i++) {
+    std::string name = reader.ReadString();
+    TypeRecord* t = new TypeRecord(name);
+    if (!mapstoinstances_.insert(std::make_pair(name, t)).second) {
+      delete t;
+      valid = false;
+    }
+    records.push_back(t);
+  }
+
+  std::vector<DetailedTypeRecord*> detailed_records;
+  count = reader.ReadU64();
+  for (uint64_t i = 0; i < count && valid && !reader.failed(); i++) {
+    std::string key_name = reader.ReadString();
+    std::string name = reader.ReadString();
+    uint64_t own_descriptors_count = reader.ReadU64();
+    uint64_t indexed_properties_count = reader.ReadU64();
+    DetailedTypeRecord* t = new DetailedTypeRecord(
+        name, own_descriptors_count, indexed_properties_count);
+    if (!detailedmapstoinstances_.insert(std::make_pair(key_name, t)).second) {
+      delete t;
+      valid = false;
+    }
+    detailed_records.push_back(t);
+  }
+
+  valid = valid && !reader.failed() &&
+          objects_.Load(reader, records, detailed_records);
+
+  std::vector<uint64_t> contexts;
+  reader.ReadArray(contexts);
+
+  std::vector<HeapPage> pages;
+  count = reader.ReadU64();
+  for (uint64_t i = 0; i < count && valid && !reader.failed(); i++) {
+    HeapPage page;
+    page.start = reader.ReadU64();
+    page.end = reader.ReadU64();
+    uint64_t space = reader.ReadU64();
+    if (space > v8::MemoryChunk::kUnknownSpace) valid = false;
+    page.space = static_cast<v8::MemoryChunk::Space>(space);
+    pages.push_back(page);
+  }
+
+  SpaceStatistics space_statistics[v8::MemoryChunk::kUnknownSpace + 1];
+  for (SpaceStatistics& statistics : space_statistics) {
+    statistics.count = reader.ReadU64();
+    statistics.size = reader.ReadU64();
+  }
+
+  if (valid && reader.ReadU64() != 0)
+    valid = references_by_value_.Load(reader);
+
+  if (valid && reader.ReadU64() != 0) valid = string_index_.Load(reader);
+
+  if (!valid || reader.failed()) {
+    Error::PrintInDebugMode("Ignoring invalid scan index '%s'", path.c_str());
+    ClearMapsToInstances();
+    references_by_value_.Clear();
+    string_index_.Clear();
+    return false;
+  }
+
+  contexts_.insert(contexts.begin(), contexts.end());
+  pages_ = pages;
+  for (size_t i = 0; i <= v8::MemoryChunk::kUnknownSpace; i++)
+    space_statistics_[i] = space_statistics[i];
+
+  Error::PrintInDebugMode("Loaded scan index '%s', %zu objects", path.c_str(),
+                          objects_.size());
+  return true;
+}
+
+
+/* Split the ranges in fixed size chunks and hand them out to `threads`
+ * workers. Every worker has its own visitor, and so its own map cache and
+ * results, which are merged once all the chunks have been scanned. Progress
+ * is only ever reported from the calling thread.
+ */
+void LLScan::ScanMemoryRangesParallel(std::vector<MemoryRange>& ranges,
+                                      uint32_t threads, HeapScanMonitor* scan) {
+  const uint64_t chunk_size = 64 * 1024 * 1024;
+  const uint64_t block_size = 1024 * 1024 * addr_size_;
+
+  std::vector<MemoryRange> chunks;
+  for (const MemoryRange& range : ranges) {
+    for (uint64_t offset = 0; offset < range.length_; offset += chunk_size) {
+      chunks.emplace_back(range.start_ + offset,
+                          std::min(chunk_size, range.length_ - offset));
+    }
+  }
+
+  // Accessors load constants lazily, make sure none is left for the workers
+  llv8_->PreloadConstants();
+
+  std::vector<FindJSObjectsVisitor::Shard*> shards;
+  std::vector<FindJSObjectsVisitor*> visitors;
+  for (uint32_t i = 0; i < threads; i++) {
+    shards.push_back(new FindJSObjectsVisitor::Shard());
+    visitors.push_back(new FindJSObjectsVisitor(target_, this, shards[i]));
+  }
+
+  std::atomic<uint32_t> next_chunk(0);
+  std::atomic<uint32_t> finished_chunks(0);
+  std::atomic<bool> stop(false);
+  const uint32_t total = chunks.size();
+
+  std::vector<std::thread> workers;
+  for (uint32_t i = 0; i < threads; i++) {
+    FindJSObjectsVisitor* v = visitors[i];
+    workers.emplace_back([&, v]() {
+      unsigned char* block = new unsigned char[block_size];
+      while (!stop) {
+        uint32_t chunk = next_chunk++;
+        if (chunk >= total) break;
+
+        if (!ScanMemoryRange(*v, chunks[chunk].start_, chunks[chunk].length_,
+                             block))
+          stop = true;
+        finished_chunks++;
       }
+      delete[] block;
+    });
+  }
+
+  if (scan != nullptr) {
+    while (finished_chunks < total && !stop) {
+      scan(llnode_, finished_chunks, total);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
   }
 
-  delete[] block;
+  for (std::thread& worker : workers) worker.join();
+
+  for (uint32_t i = 0; i < threads; i++) {
+    MergeShard(shards[i]);
+    delete visitors[i];
+    delete shards[i];
+  }
+}
+
+
+void LLScan::MergeShard(FindJSObjectsVisitor::Shard* shard) {
+  // Shard records of types we already know are replaced by ours, the
+  // others are taken over as they are.
+  std::unordered_map<TypeRecord*, TypeRecord*> replaced;
+
+  for (auto entry : shard->maps_to_instances) {
+    TypeRecord*& t = mapstoinstances_[entry.first];
+    if (t == nullptr)
+      t = entry.second;
+    else
+      replaced[entry.second] = t;
+  }
+
+  for (auto entry : shard->detailed_maps_to_instances) {
+    DetailedTypeRecord*& t = detailedmapstoinstances_[entry.first];
+    if (t == nullptr)
+      t = entry.second;
+    else
+      replaced[entry.second] = t;
+  }
+
+  // Objects found by several workers are deduplicated by Finalize()
+  objects_.Merge(shard->objects, replaced);
+  for (auto entry : replaced) delete entry.first;
+
+  contexts_.insert(shard->contexts.begin(), shard->contexts.end());
+
+  heap_walk_skips_.bytes += shard->skips.bytes;
+  heap_walk_skips_.types.insert(shard->skips.types.begin(),
+                                shard->skips.types.end());
+}
+
+
+/* Number of threads used to scan the heap, from LLNODE_SCAN_THREADS.
+ * Defaults to a single thread, 0 means one per available core.
+ */
+uint32_t LLScan::GetScanThreadCount() {
+  const char* threads = getenv("LLNODE_SCAN_THREADS");
+  if (threads == nullptr || *threads == '\0') return 1;
+
+  uint32_t count = strtoul(threads, nullptr, 10);
+  if (count == 0) count = std::thread::hardware_concurrency();
+  return std::max<uint32_t>(count, 1);
 }
 
 
@@ -1594,6 +2880,40 @@ bool LLScan::GenerateMemoryRanges(lldb::SBTarget target,
 }
 
 
+/* Build the memory ranges from the segments of the mapped core file.
+ * Only writable segments can hold the V8 heap. Segments the core is missing
+ * are skipped and truncated ones are cut down to the data the file has, so
+ * no probing through LLDB is needed.
+ */
+void LLScan::GenerateMemoryRangesFromCore() {
+  MemoryRange** tailptr = &ranges_;
+  uint32_t missing = 0;
+  uint32_t truncated = 0;
+
+  for (const CoreMemoryReader::Segment& segment : llv8_->core().segments()) {
+    if (!segment.IsWritable()) continue;
+
+    if (segment.IsTruncated()) truncated++;
+    if (segment.available() == 0) {
+      missing++;
+      continue;
+    }
+
+    MemoryRange* newRange =
+        new MemoryRange(segment.start(), segment.available());
+
+    *tailptr = newRange;
+    tailptr = &(newRange->next_);
+  }
+
+  if (missing != 0 || truncated != 0) {
+    Error::PrintInDebugMode(
+        "Core '%s' has %" PRIu32 " truncated and %" PRIu32 " missing segments",
+        llv8_->core().path().c_str(), truncated, missing);
+  }
+}
+
+
 void LLScan::ClearMemoryRanges() {
   MemoryRange* head = ranges_;
   while (head != nullptr) {
@@ -1602,6 +2922,7 @@ void LLScan::ClearMemoryRanges() {
     delete range;
   }
   ranges_ = nullptr;
+  pages_.clear();
 }
 
 
@@ -1612,27 +2933,25 @@ void LLScan::ClearMapsToInstances() {
     delete t;
   }
   mapstoinstances_.clear();
+
+  // Detailed records are views over the object table too
+  for (auto entry : detailedmapstoinstances_) delete entry.second;
+  detailedmapstoinstances_.clear();
+  objects_.Clear();
+  heap_walk_skips_ = HeapWalkSkips();
 }
 
 void LLScan::ClearReferences() {
   ReferencesVector* references;
 
-  for (auto entry : references_by_value_) {
-    references = entry.second;
-    delete references;
-  }
-  references_by_value_.clear();
+  references_by_value_.Clear();
+  dominators_.Clear();
+  string_index_.Clear();
 
   for (auto entry : references_by_property_) {
     references = entry.second;
     delete references;
   }
   references_by_property_.clear();
-
-  for (auto entry : references_by_string_) {
-    references = entry.second;
-    delete references;
-  }
-  references_by_string_.clear();
 }
 }  // namespace llnode
@@ -4,22 +4,27 @@
 #include <lldb/API/LLDB.h>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <unordered_set>
 
+#include "src/address-map.h"
 #include "src/error.h"
+#include "src/heap-graph.h"
 #include "src/llnode-module.h"
 #include "src/llnode.h"
+#include "src/object-table.h"
+#include "src/string-index.h"
 
 namespace llnode {
 
 class LLScan;
+class TypeRecord;
 
 typedef std::vector<uint64_t> ReferencesVector;
 typedef std::unordered_set<uint64_t> ContextVector;
 
-typedef std::map<uint64_t, ReferencesVector*> ReferencesByValueMap;
 typedef std::map<std::string, ReferencesVector*> ReferencesByPropertyMap;
-typedef std::map<std::string, ReferencesVector*> ReferencesByStringMap;
+typedef std::unordered_map<TypeRecord*, uint64_t> RetainedSizeMap;
 
 typedef void(HeapScanMonitor)(LLNode* llnode, uint32_t now, uint32_t total);
 
@@ -27,17 +32,24 @@ char** ParseInspectOptions(char** cmd, v8::Value::InspectOptions* options);
 
 class FindObjectsCmd : public CommandBase {
  public:
-  FindObjectsCmd(LLScan* llscan) : llscan_(llscan) {}
+  FindObjectsCmd(LLScan* llscan, node::Node* node)
+      : llscan_(llscan), node_(node) {}
   ~FindObjectsCmd() override {}
 
   bool DoExecute(lldb::SBDebugger d, char** cmd,
                  lldb::SBCommandReturnObject& result) override;
 
-  void SimpleOutput(lldb::SBCommandReturnObject& result);
-  void DetailedOutput(lldb::SBCommandReturnObject& result);
+  // `retained` is null unless retained sizes were requested
+  void SimpleOutput(lldb::SBCommandReturnObject& result,
+                    const RetainedSizeMap* retained);
+  void DetailedOutput(lldb::SBCommandReturnObject& result,
+                      const RetainedSizeMap* retained);
 
  private:
+  char** ParseFindObjectsOptions(char** cmd, bool* detailed, bool* retained);
+
   LLScan* llscan_;
+  node::Node* node_;
 };
 
 class FindInstancesCmd : public CommandBase {
@@ -86,9 +98,25 @@ class FindReferencesCmd : public CommandBase {
 
     virtual ReferencesVector* GetReferences() { return nullptr; };
 
+    // Scanners searching for several values at once report the references
+    // to one of them at a time, GetReferences() and PrintRefs() use the
+    // selected one.
+    virtual size_t GetSearchValueCount() { return 1; };
+    virtual std::string GetSearchValue(size_t index) { return std::string(); };
+    virtual void SelectSearchValue(size_t index){};
+
+    // Called once ScanRefs() has seen every object
+    virtual void ScanFinished(){};
+
     virtual void ScanRefs(v8::JSObject& js_obj, Error& err){};
     virtual void ScanRefs(v8::String& str, Error& err){};
 
+    // Called for objects whose map is already known
+    virtual void ScanObjectRefs(v8::JSObject& js_obj, v8::Map& map,
+                                Error& err) {
+      ScanRefs(js_obj, err);
+    };
+
     virtual void PrintRefs(lldb::SBCommandReturnObject& result,
                            v8::JSObject& js_obj, Error& err) {}
     virtual void PrintRefs(lldb::SBCommandReturnObject& result, v8::String& str,
@@ -106,6 +134,29 @@ class FindReferencesCmd : public CommandBase {
 
   void ScanForReferences(ObjectScanner* scanner);
 
+  /* Strings searched for in a single pass. Candidates are first filtered
+   * on their length, which is read without reading their characters.
+   */
+  class StringSet {
+   public:
+    void Insert(const std::string& value);
+
+    inline bool empty() const { return values_.empty(); };
+    inline const std::unordered_set<std::string>& values() const {
+      return values_;
+    };
+
+    bool MayContain(v8::String& str, Error& err) const;
+    inline bool Contains(const std::string& value) const {
+      return values_.count(value) != 0;
+    };
+
+   private:
+    std::unordered_set<std::string> values_;
+    // Both the UTF-8 and the UTF-16 length of every value
+    std::unordered_set<int64_t> lengths_;
+  };
+
   class ReferenceScanner : public ObjectScanner {
    public:
     ReferenceScanner(LLScan* llscan, v8::Value search_value)
@@ -117,6 +168,7 @@ class FindReferencesCmd : public CommandBase {
 
     void ScanRefs(v8::JSObject& js_obj, Error& err) override;
     void ScanRefs(v8::String& str, Error& err) override;
+    void ScanFinished() override;
 
     void PrintRefs(lldb::SBCommandReturnObject& result, v8::JSObject& js_obj,
                    Error& err) override;
@@ -129,18 +181,32 @@ class FindReferencesCmd : public CommandBase {
    private:
     LLScan* llscan_;
     v8::Value search_value_;
+    ReferencesVector references_;
   };
 
   class PropertyScanner : public ObjectScanner {
    public:
-    PropertyScanner(LLScan* llscan, std::string search_value)
-        : llscan_(llscan), search_value_(search_value) {}
+    PropertyScanner(LLScan* llscan,
+                    const std::vector<std::string>& search_values);
 
     bool AreReferencesLoaded() override;
 
     ReferencesVector* GetReferences() override;
 
+    inline size_t GetSearchValueCount() override {
+      return search_values_.size();
+    };
+    inline std::string GetSearchValue(size_t index) override {
+      return search_values_[index];
+    };
+    inline void SelectSearchValue(size_t index) override {
+      search_value_ = search_values_[index];
+    };
+
     void ScanRefs(v8::JSObject& js_obj, Error& err) override;
+    void ScanObjectRefs(v8::JSObject& js_obj, v8::Map& map,
+                        Error& err) override;
+    void ScanFinished() override;
 
     // We only scan properties on objects not Strings, use default no-op impl
     // of PrintRefs for Strings.
@@ -148,22 +214,47 @@ class FindReferencesCmd : public CommandBase {
                    Error& err) override;
 
    private:
+    // Search values among the property names of a map
+    struct MapNames {
+      bool dictionary;
+      std::vector<std::string> names;
+    };
+
+    MapNames LoadMapNames(v8::Map& map);
+
     LLScan* llscan_;
+    std::vector<std::string> search_values_;
     std::string search_value_;
+    // Search values whose references aren't loaded yet
+    StringSet pending_;
+    // Map address to index in map_names_
+    AddressMap<uint32_t> map_cache_;
+    std::vector<MapNames> map_names_;
   };
 
 
+  /* Objects referencing strings with one of the search values. The strings
+   * are looked up in the string index and their referrers in the reference
+   * index, neither needs a scan of its own once built.
+   */
   class StringScanner : public ObjectScanner {
    public:
-    StringScanner(LLScan* llscan, std::string search_value)
-        : llscan_(llscan), search_value_(search_value) {}
+    StringScanner(LLScan* llscan,
+                  const std::vector<std::string>& search_values);
 
-    bool AreReferencesLoaded() override;
+    bool AreReferencesLoaded() override { return true; };
 
     ReferencesVector* GetReferences() override;
 
-    void ScanRefs(v8::JSObject& js_obj, Error& err) override;
-    void ScanRefs(v8::String& str, Error& err) override;
+    inline size_t GetSearchValueCount() override {
+      return search_values_.size();
+    };
+    inline std::string GetSearchValue(size_t index) override {
+      return search_values_[index];
+    };
+    inline void SelectSearchValue(size_t index) override {
+      search_value_ = search_values_[index];
+    };
 
     void PrintRefs(lldb::SBCommandReturnObject& result, v8::JSObject& js_obj,
                    Error& err) override;
@@ -175,13 +266,62 @@ class FindReferencesCmd : public CommandBase {
 
    private:
     LLScan* llscan_;
+    std::vector<std::string> search_values_;
     std::string search_value_;
+    ReferencesVector references_;
   };
 
  private:
   LLScan* llscan_;  // FindReferencesCmd::llscan_
 };
 
+class RetainersCmd : public CommandBase {
+ public:
+  RetainersCmd(LLScan* llscan, node::Node* node)
+      : llscan_(llscan), node_(node) {}
+  ~RetainersCmd() override {}
+
+  bool DoExecute(lldb::SBDebugger d, char** cmd,
+                 lldb::SBCommandReturnObject& result) override;
+
+ private:
+  char** ParseRetainersOptions(char** cmd, uint32_t* max_depth,
+                               uint32_t* max_paths, bool* bad_option);
+
+  LLScan* llscan_;
+  node::Node* node_;
+};
+
+class RetainedCmd : public CommandBase {
+ public:
+  RetainedCmd(LLScan* llscan, node::Node* node)
+      : llscan_(llscan), node_(node) {}
+  ~RetainedCmd() override {}
+
+  bool DoExecute(lldb::SBDebugger d, char** cmd,
+                 lldb::SBCommandReturnObject& result) override;
+
+ private:
+  LLScan* llscan_;
+  node::Node* node_;
+};
+
+class FindStringsCmd : public CommandBase {
+ public:
+  FindStringsCmd(LLScan* llscan) : llscan_(llscan) {}
+  ~FindStringsCmd() override {}
+
+  bool DoExecute(lldb::SBDebugger d, char** cmd,
+                 lldb::SBCommandReturnObject& result) override;
+
+ private:
+  enum MatchType { kEqual, kContains, kPrefix, kBadOption };
+
+  char** ParseFindStringsOptions(char** cmd, MatchType* type);
+
+  LLScan* llscan_;
+};
+
 class MemoryVisitor {
  public:
   virtual ~MemoryVisitor() {}
@@ -199,15 +339,8 @@ class TypeRecord {
   inline std::string& GetTypeName() { return type_name_; };
   inline uint64_t GetInstanceCount() { return instance_count_; };
   inline uint64_t GetTotalInstanceSize() { return total_instance_size_; };
-  inline std::unordered_set<uint64_t>& GetInstances() { return instances_; };
-
-  inline void AddInstance(uint64_t address, uint64_t size) {
-    auto result = instances_.insert(address);
-    if (result.second) {
-      instance_count_++;
-      total_instance_size_ += size;
-    }
-  };
+  // Only valid once the ObjectTable of the scan has been finalized
+  inline InstanceRange GetInstances() { return instances_; };
 
   /* Sort records by instance count, use the other fields as tie breakers
    * to give consistent ordering.
@@ -231,10 +364,11 @@ class TypeRecord {
 
  private:
   friend class DetailedTypeRecord;
+  friend class ObjectTable;
   std::string type_name_;
   uint64_t instance_count_;
   uint64_t total_instance_size_;
-  std::unordered_set<uint64_t> instances_;
+  InstanceRange instances_;
 };
 
 class DetailedTypeRecord : public TypeRecord {
@@ -258,9 +392,29 @@ class DetailedTypeRecord : public TypeRecord {
 typedef std::map<std::string, TypeRecord*> TypeRecordMap;
 typedef std::map<std::string, DetailedTypeRecord*> DetailedTypeRecordMap;
 
+/* Memory the heap walk skipped after objects it couldn't find the size of,
+ * and the instance types of those objects.
+ */
+struct HeapWalkSkips {
+  uint64_t bytes = 0;
+  std::set<int64_t> types;
+};
+
 class FindJSObjectsVisitor : MemoryVisitor {
  public:
-  FindJSObjectsVisitor(lldb::SBTarget& target, LLScan* llscan);
+  /* Results of one worker of a parallel scan, merged into LLScan once all
+   * the workers are done.
+   */
+  struct Shard {
+    TypeRecordMap maps_to_instances;
+    DetailedTypeRecordMap detailed_maps_to_instances;
+    ContextVector contexts;
+    ObjectTable objects;
+    HeapWalkSkips skips;
+  };
+
+  FindJSObjectsVisitor(lldb::SBTarget& target, LLScan* llscan,
+                       Shard* shard = nullptr);
   ~FindJSObjectsVisitor() {}
 
   uint64_t Visit(uint64_t location, uint64_t word);
@@ -282,6 +436,10 @@ class FindJSObjectsVisitor : MemoryVisitor {
     uint64_t own_descriptors_count_ = 0;
     uint64_t indexed_properties_count_ = 0;
 
+    // Resolved once per map, so recording an instance is a single append
+    // to the object table
+    uint32_t map_id = 0;
+
     std::string GetTypeNameWithProperties(
         ShowArrayLength show_array_length = kShowArrayLength,
         size_t max_properties = 0);
@@ -292,20 +450,31 @@ class FindJSObjectsVisitor : MemoryVisitor {
 
   static bool IsAHistogramType(v8::Map& map, Error& err);
 
+  uint64_t VisitObjectStart(uint64_t location, uint64_t word);
+  void RecordObject(uint64_t word, v8::HeapObject heap_object, v8::Map map);
+
+  MapCacheEntry* LoadMapCacheEntry(v8::Map map, v8::HeapObject heap_object);
+
   void InsertOnContexts(uint64_t word, Error& err);
-  void InsertOnMapsToInstances(uint64_t word, v8::Map map,
-                               FindJSObjectsVisitor::MapCacheEntry map_info,
-                               Error& err);
-  void InsertOnDetailedMapsToInstances(
-      uint64_t word, v8::Map map, FindJSObjectsVisitor::MapCacheEntry map_info,
-      Error& err);
+  TypeRecord* GetTypeRecord(MapCacheEntry& map_info);
+  DetailedTypeRecord* GetDetailedTypeRecord(MapCacheEntry& map_info);
 
   lldb::SBTarget& target_;
   uint32_t address_byte_size_;
   uint32_t found_count_;
+  bool heap_walk_;
 
   LLScan* const llscan_;
-  std::map<int64_t, MapCacheEntry> map_cache_;
+  // Map address to index in map_entries_
+  AddressMap<uint32_t> map_cache_;
+  std::vector<MapCacheEntry> map_entries_;
+
+  Shard* shard_;
+  TypeRecordMap* maps_to_instances_;
+  DetailedTypeRecordMap* detailed_maps_to_instances_;
+  ContextVector* contexts_;
+  ObjectTable* objects_;
+  HeapWalkSkips* skips_;
 };
 
 
@@ -326,21 +495,31 @@ class LLScan {
   inline DetailedTypeRecordMap& GetDetailedMapsToInstances() {
     return detailedmapstoinstances_;
   };
+  inline ObjectTable& GetObjectTable() { return objects_; };
 
   // References By Value
   inline bool AreReferencesByValueLoaded() {
-    return references_by_value_.size() > 0;
+    return references_by_value_.IsBuilt();
   };
-  inline ReferencesVector* GetReferencesByValue(uint64_t address) {
-    if (references_by_value_.count(address) == 0) {
-      references_by_value_[address] = new ReferencesVector;
-    }
-    return references_by_value_[address];
+  inline ReferenceIndex& GetReferencesByValue() {
+    return references_by_value_;
   };
-
-  // References By Property
-  inline bool AreReferencesByPropertyLoaded() {
-    return references_by_property_.size() > 0;
+  void FinishReferencesByValue();
+  void LoadReferencesByValue();
+
+  // Retainers, need the references by value
+  void FindRetainers(uint64_t address, node::Node* node, uint32_t max_depth,
+                     uint32_t max_paths, std::vector<RetainerPath>& paths);
+  std::string GetReferenceName(uint64_t source, uint64_t target);
+
+  // Dominators and retained sizes, need the references by value
+  bool LoadDominatorTree(node::Node* node);
+  inline DominatorTree& GetDominatorTree() { return dominators_; };
+  void GetTypeRetainedSizes(bool detailed, RetainedSizeMap& sizes);
+
+  // References By Property, only known for the property names searched
+  inline bool AreReferencesByPropertyLoaded(const std::string& property) {
+    return references_by_property_.count(property) != 0;
   };
   inline ReferencesVector* GetReferencesByProperty(std::string property) {
     if (references_by_property_.count(property) == 0) {
@@ -349,31 +528,33 @@ class LLScan {
     return references_by_property_[property];
   };
 
-  // References By String
-  inline bool AreReferencesByStringLoaded() {
-    return references_by_string_.size() > 0;
-  };
-  inline ReferencesVector* GetReferencesByString(std::string string_value) {
-    if (references_by_string_.count(string_value) == 0) {
-      references_by_string_[string_value] = new ReferencesVector;
-    }
-    return references_by_string_[string_value];
-  };
+  // String contents, `grams` also indexes them for substring searches
+  bool LoadStringIndex(bool grams);
+  inline StringIndex& GetStringIndex() { return string_index_; };
+  // Reads the contents of the indexed strings
+  StringIndex::ContentFunction GetStringContent();
 
   // Contexts
   inline bool AreContextsLoaded() { return contexts_.size() > 0; };
   inline ContextVector* GetContexts() { return &contexts_; }
 
+  // V8 heap pages, only known after a page aware scan
+  struct SpaceStatistics {
+    uint64_t count = 0;
+    uint64_t size = 0;
+  };
+  inline bool AreHeapPagesLoaded() { return !pages_.empty(); };
+  inline HeapWalkSkips& GetHeapWalkSkips() { return heap_walk_skips_; };
+  v8::MemoryChunk::Space GetSpace(uint64_t address);
+  inline const SpaceStatistics& GetSpaceStatistics(
+      v8::MemoryChunk::Space space) {
+    return space_statistics_[space];
+  };
+
   v8::LLV8* llv8_;
   LLNode* llnode_;
 
  private:
-  void ScanMemoryRanges(FindJSObjectsVisitor& v,
-                        HeapScanMonitor* scan = nullptr);
-  void ClearMemoryRanges();
-  void ClearMapsToInstances();
-  void ClearReferences();
-
   class MemoryRange {
    public:
     MemoryRange(uint64_t start, uint64_t length)
@@ -384,15 +565,53 @@ class LLScan {
     MemoryRange* next_;
   };
 
+  void ScanMemoryRanges(FindJSObjectsVisitor& v,
+                        HeapScanMonitor* scan = nullptr);
+  void ScanMemoryRangesParallel(std::vector<MemoryRange>& ranges,
+                                uint32_t threads, HeapScanMonitor* scan);
+  bool ScanMemoryRange(FindJSObjectsVisitor& v, uint64_t address,
+                       uint64_t len, unsigned char* block);
+  void MergeShard(FindJSObjectsVisitor::Shard* shard);
+  static uint32_t GetScanThreadCount();
+  void GenerateMemoryRangesFromCore();
+  bool FindHeapPages(const std::vector<MemoryRange>& ranges);
+  void ComputeSpaceStatistics();
+  std::string GetScanIndexPath();
+  bool LoadScanIndexKey(ScanIndexKey& key);
+  void SaveScanIndex();
+  bool LoadScanIndex();
+  void FindHandleObjects(node::Node* node,
+                         std::unordered_set<uint64_t>& handles);
+  bool IsRootCandidate(uint64_t object,
+                       const std::unordered_set<uint64_t>& handles,
+                       std::string& reason);
+  void ClearMemoryRanges();
+  void ClearMapsToInstances();
+  void ClearReferences();
+
   lldb::SBTarget target_;
   lldb::SBProcess process_;
+  uint64_t addr_size_ = 8;
+  bool swap_bytes_ = false;
   MemoryRange* ranges_ = nullptr;
+
+  // Object area of every V8 heap page, sorted by address
+  struct HeapPage {
+    uint64_t start;
+    uint64_t end;
+    v8::MemoryChunk::Space space;
+  };
+  std::vector<HeapPage> pages_;
+  SpaceStatistics space_statistics_[v8::MemoryChunk::kUnknownSpace + 1];
   TypeRecordMap mapstoinstances_;
   DetailedTypeRecordMap detailedmapstoinstances_;
+  ObjectTable objects_;
+  HeapWalkSkips heap_walk_skips_;
 
-  ReferencesByValueMap references_by_value_;
+  ReferenceIndex references_by_value_;
+  DominatorTree dominators_;
+  StringIndex string_index_;
   ReferencesByPropertyMap references_by_property_;
-  ReferencesByStringMap references_by_string_;
   ContextVector contexts_;
 };
 
@@ -232,6 +232,9 @@ void SharedInfo::Load() {
 void Code::Load() {
   kStartOffset = LoadConstant("class_Code__instruction_start__uintptr_t");
   kSizeOffset = LoadConstant("class_Code__instruction_size__int");
+  // Code objects are 32 bytes aligned on all the architectures llnode
+  // supports
+  kCodeAlignment = LoadConstant("CodeAlignment", 32);
 }
 
 
@@ -314,6 +317,20 @@ void ThinString::Load() {
   kActualOffset = LoadConstant("class_ThinString__actual__String");
 }
 
+void ExternalString::Load() {
+  common_->Load();
+  int64_t pointer_size = common_->kPointerSize;
+
+  // The resource is an embedder object, V8 caches the address of its
+  // characters right after it unless the string is uncached (short).
+  kResourceOffset = LoadConstant("class_ExternalString__resource__Object");
+  kResourceDataOffset =
+      LoadConstant("class_ExternalString__resource_data__char",
+                   kResourceOffset == -1 ? -1 : kResourceOffset + pointer_size);
+  kUncachedMask = LoadConstant("UncachedExternalStringMask",
+                               "ShortExternalStringMask", 1 << 4);
+}
+
 void FixedArrayBase::Load() {
   kLengthOffset = LoadConstant("class_FixedArrayBase__length__SMI");
 }
@@ -325,10 +342,71 @@ void FixedArray::Load() {
 
 
 void FixedTypedArrayBase::Load() {
+  common_->Load();
   kBasePointerOffset =
       LoadConstant("class_FixedTypedArrayBase__base_pointer__Object");
   kExternalPointerOffset =
       LoadConstant("class_FixedTypedArrayBase__external_pointer__Object");
+
+  // The elements of on-heap typed arrays follow the external pointer,
+  // double aligned
+  kDataOffset = -1;
+  if (kExternalPointerOffset != -1)
+    kDataOffset = (kExternalPointerOffset + common_->kPointerSize + 7) & ~7;
+}
+
+
+void PropertyArray::Load() {
+  // V8 doesn't describe PropertyArray in the postmortem metadata: a
+  // HeapObject header, then a Smi holding the length in its low 10 bits and
+  // the hash above them, then the slots.
+  common_->Load();
+  int64_t pointer_size = common_->kPointerSize;
+
+  kLengthAndHashOffset =
+      LoadConstant("class_PropertyArray__length_and_hash__SMI", pointer_size);
+  kLengthMask = LoadConstant("PropertyArray__LengthField__kMask", 0x3ff);
+  kHeaderSize = kLengthAndHashOffset + pointer_size;
+}
+
+
+void WeakArrayList::Load() {
+  // A HeapObject header, then the capacity and the length as Smis
+  common_->Load();
+  int64_t pointer_size = common_->kPointerSize;
+
+  kCapacityOffset =
+      LoadConstant("class_WeakArrayList__capacity__SMI", pointer_size);
+  kHeaderSize = kCapacityOffset + 2 * pointer_size;
+}
+
+
+void BytecodeArray::Load() {
+  // The FixedArrayBase header is followed by the constant pool, handler
+  // table and source position table, then by int fields: frame size,
+  // parameter size and interrupt budget, the incoming new target register
+  // since V8 6.2, and by the int8 OSR nesting level and age since V8 5.2.
+  common_->Load();
+  int64_t pointer_size = common_->kPointerSize;
+
+  int64_t header_size = 5 * pointer_size + 3 * 4;
+  if (common_->CheckLowestVersion(6, 2, 0)) header_size += 4;
+  if (common_->CheckLowestVersion(5, 2, 0)) header_size += 2;
+  kHeaderSize = LoadConstant("BytecodeArray__kHeaderSize", header_size);
+}
+
+
+void FeedbackVector::Load() {
+  // A HeapObject header, the SharedFunctionInfo and optimized code, then
+  // the int length and counters, padded to the pointer size before the
+  // slots.
+  common_->Load();
+  int64_t pointer_size = common_->kPointerSize;
+
+  kLengthOffset =
+      LoadConstant("class_FeedbackVector__length__int", 3 * pointer_size);
+  kHeaderSize =
+      LoadConstant("FeedbackVector__kHeaderSize", 5 * pointer_size);
 }
 
 
@@ -485,6 +563,31 @@ void Symbol::Load() {
   kNameOffset = LoadConstant("class_Symbol__name__Object");
 }
 
+void MemoryChunk::Load() {
+  // V8 doesn't describe its pages in the postmortem metadata, so the defaults
+  // below follow the MemoryChunk header of the V8 versions llnode supports.
+  common_->Load();
+  int64_t pointer_size = common_->kPointerSize;
+
+  // Pages are 256KB or 512KB depending on the version, both are aligned to
+  // the smaller one
+  kAlignment = LoadConstant("MemoryChunk__kAlignment", 1 << 18);
+
+  kSizeOffset = LoadConstant("class_MemoryChunk__size__size_t", int64_t(0));
+  kFlagsOffset =
+      LoadConstant("class_MemoryChunk__flags__uintptr_t", pointer_size);
+  // V8 7 added a pointer to the Heap right after the flags
+  int64_t area_start = common_->CheckLowestVersion(7, 0, 0) ? 3 : 2;
+  kAreaStartOffset = LoadConstant("class_MemoryChunk__area_start__Address",
+                                  area_start * pointer_size);
+  kAreaEndOffset = LoadConstant("class_MemoryChunk__area_end__Address",
+                                kAreaStartOffset + pointer_size);
+
+  kIsExecutableFlag = LoadConstant("MemoryChunk__IS_EXECUTABLE", 1 << 0);
+  kInFromSpaceFlag = LoadConstant("MemoryChunk__IN_FROM_SPACE", 1 << 3);
+  kInToSpaceFlag = LoadConstant("MemoryChunk__IN_TO_SPACE", 1 << 4);
+}
+
 void Types::Load() {
   kFirstNonstringType = LoadConstant("FirstNonstringType");
   kFirstJSObjectType =
@@ -508,6 +611,10 @@ void Types::Load() {
   kCodeType = LoadConstant("type_Code__CODE_TYPE");
   kJSFunctionType = LoadConstant("type_JSFunction__JS_FUNCTION_TYPE");
   kFixedArrayType = LoadConstant("type_FixedArray__FIXED_ARRAY_TYPE");
+  kFixedDoubleArrayType =
+      LoadConstant("type_FixedDoubleArray__FIXED_DOUBLE_ARRAY_TYPE");
+  kByteArrayType = LoadConstant("type_ByteArray__BYTE_ARRAY_TYPE");
+  kFreeSpaceType = LoadConstant("type_FreeSpace__FREE_SPACE_TYPE");
   kJSArrayBufferType = LoadConstant("type_JSArrayBuffer__JS_ARRAY_BUFFER_TYPE");
   kJSTypedArrayType = LoadConstant("type_JSTypedArray__JS_TYPED_ARRAY_TYPE");
   kJSRegExpType = LoadConstant("type_JSRegExp__JS_REGEXP_TYPE");
@@ -518,6 +625,75 @@ void Types::Load() {
   kScopeInfoType = LoadConstant("type_ScopeInfo__SCOPE_INFO_TYPE");
   kSymbolType = LoadConstant("type_Symbol__SYMBOL_TYPE");
 
+  kFirstFixedArrayType = LoadConstant("FirstFixedArrayType");
+  kLastFixedArrayType = LoadConstant("LastFixedArrayType");
+  kWeakFixedArrayType =
+      LoadConstant("type_WeakFixedArray__WEAK_FIXED_ARRAY_TYPE");
+  kWeakArrayListType = LoadConstant("type_WeakArrayList__WEAK_ARRAY_LIST_TYPE");
+  kPropertyArrayType = LoadConstant("type_PropertyArray__PROPERTY_ARRAY_TYPE");
+  kBytecodeArrayType =
+      LoadConstant("type_BytecodeArray__BYTECODE_ARRAY_TYPE");
+  kDescriptorArrayType =
+      LoadConstant("type_DescriptorArray__DESCRIPTOR_ARRAY_TYPE");
+  kFeedbackVectorType =
+      LoadConstant("type_FeedbackVector__FEEDBACK_VECTOR_TYPE");
+
+  // Most of these are within the fixed array range on the versions which
+  // have one. Descriptor and transition arrays are FixedArrays or
+  // WeakFixedArrays on the versions llnode reads their descriptors from.
+  static const char* fixed_array_types[] = {
+      "type_HashTable__HASH_TABLE_TYPE",
+      "type_OrderedHashMap__ORDERED_HASH_MAP_TYPE",
+      "type_OrderedHashSet__ORDERED_HASH_SET_TYPE",
+      "type_NameDictionary__NAME_DICTIONARY_TYPE",
+      "type_GlobalDictionary__GLOBAL_DICTIONARY_TYPE",
+      "type_NumberDictionary__NUMBER_DICTIONARY_TYPE",
+      "type_SimpleNumberDictionary__SIMPLE_NUMBER_DICTIONARY_TYPE",
+      "type_StringTable__STRING_TABLE_TYPE",
+      "type_EphemeronHashTable__EPHEMERON_HASH_TABLE_TYPE",
+      "type_ScriptContextTable__SCRIPT_CONTEXT_TABLE_TYPE",
+      "type_BoilerplateDescription__BOILERPLATE_DESCRIPTION_TYPE",
+      "type_ObjectBoilerplateDescription__OBJECT_BOILERPLATE_DESCRIPTION_TYPE",
+      "type_TemplateList__TEMPLATE_LIST_TYPE",
+      "type_TransitionArray__TRANSITION_ARRAY_TYPE"};
+  fixed_array_types_.clear();
+  for (const char* name : fixed_array_types) {
+    int64_t type = LoadConstant(name);
+    if (type != -1) fixed_array_types_.push_back(type);
+  }
+  fixed_array_types_.push_back(kFixedArrayType);
+  fixed_array_types_.push_back(kScopeInfoType);
+  fixed_array_types_.push_back(kWeakFixedArrayType);
+  fixed_array_types_.push_back(kDescriptorArrayType);
+
+  static const struct {
+    const char* name;
+    int64_t element_size;
+  } fixed_typed_array_types[] = {
+      {"type_FixedInt8Array__FIXED_INT8_ARRAY_TYPE", 1},
+      {"type_FixedUint8Array__FIXED_UINT8_ARRAY_TYPE", 1},
+      {"type_FixedUint8ClampedArray__FIXED_UINT8_CLAMPED_ARRAY_TYPE", 1},
+      {"type_FixedInt16Array__FIXED_INT16_ARRAY_TYPE", 2},
+      {"type_FixedUint16Array__FIXED_UINT16_ARRAY_TYPE", 2},
+      {"type_FixedInt32Array__FIXED_INT32_ARRAY_TYPE", 4},
+      {"type_FixedUint32Array__FIXED_UINT32_ARRAY_TYPE", 4},
+      {"type_FixedFloat32Array__FIXED_FLOAT32_ARRAY_TYPE", 4},
+      {"type_FixedFloat64Array__FIXED_FLOAT64_ARRAY_TYPE", 8},
+      {"type_FixedBigInt64Array__FIXED_BIGINT64_ARRAY_TYPE", 8},
+      {"type_FixedBigUint64Array__FIXED_BIGUINT64_ARRAY_TYPE", 8}};
+  fixed_typed_array_types_.clear();
+  kFirstFixedTypedArrayType = -1;
+  kLastFixedTypedArrayType = -1;
+  for (const auto& entry : fixed_typed_array_types) {
+    int64_t type = LoadConstant(entry.name);
+    if (type == -1) continue;
+
+    fixed_typed_array_types_.emplace_back(type, entry.element_size);
+    if (kFirstFixedTypedArrayType == -1 || type < kFirstFixedTypedArrayType)
+      kFirstFixedTypedArrayType = type;
+    if (type > kLastFixedTypedArrayType) kLastFixedTypedArrayType = type;
+  }
+
   if (kJSAPIObjectType == -1) {
     common_->Load();
 
@@ -526,6 +702,80 @@ void Types::Load() {
   }
 }
 
+
+bool Types::IsFixedArrayLayout(int64_t type) const {
+  if (type == -1) return false;
+  if (kFirstFixedArrayType != -1 && type >= kFirstFixedArrayType &&
+      type <= kLastFixedArrayType)
+    return true;
+  if (type >= kFirstContextType && type <= kLastContextType) return true;
+
+  for (int64_t fixed_array_type : fixed_array_types_)
+    if (type == fixed_array_type) return true;
+  return false;
+}
+
+
+int64_t Types::FixedTypedArrayElementSize(int64_t type) const {
+  for (const auto& entry : fixed_typed_array_types_)
+    if (entry.first == type) return entry.second;
+  return -1;
+}
+
+
+void Layout::Resolve(Common* common, Smi* smi, HeapObject* heap_obj, Map* map,
+                     FixedArray* fixed_array,
+                     DescriptorArray* descriptor_array) {
+  pointer_size = (*common)()->kPointerSize;
+
+  smi_tag = (*smi)()->kTag;
+  smi_tag_mask = smi->kTagMask;
+  smi_shift = smi->kShiftSize + smi->kTagMask;
+
+  heap_object_tag = (*heap_obj)()->kTag;
+  heap_object_tag_mask = heap_obj->kTagMask;
+  map_offset = heap_obj->kMapOffset;
+
+  map_type_offset = (*map)()->kInstanceAttrsOffset;
+  map_type_mask = map->kMapTypeMask;
+  instance_descriptors_offset = map->kInstanceDescriptorsOffset;
+  bit_field3_offset = map->kBitField3Offset;
+  dictionary_map_bit = int64_t(1) << map->kDictionaryMapShift;
+  own_descriptors_mask = map->kNumberOfOwnDescriptorsMask;
+  own_descriptors_shift = map->kNumberOfOwnDescriptorsShift;
+
+  fixed_array_data_offset = (*fixed_array)()->kDataOffset;
+
+  DescriptorArray* descriptors = (*descriptor_array)();
+  descriptor_first_index = descriptors->kFirstIndex;
+  descriptor_size = descriptors->kSize;
+  descriptor_key_offset = descriptors->kKeyOffset;
+  descriptor_details_offset = descriptors->kDetailsOffset;
+  descriptor_value_offset = descriptors->kValueOffset;
+
+  if (descriptors->kPropertyTypeMask != -1) {  // node.js <= 7
+    details_mask = descriptors->kPropertyTypeMask;
+    field_details = descriptors->kFieldType;
+    const_field_details = descriptors->kConstFieldType;
+    descriptor_details = -1;
+  } else {  // node.js >= 8
+    details_mask = descriptors->kPropertyLocationMask;
+    field_details = descriptors->kPropertyLocationEnum_kField
+                    << descriptors->kPropertyLocationShift;
+    const_field_details = -1;
+    descriptor_details = descriptors->kPropertyLocationEnum_kDescriptor
+                         << descriptors->kPropertyLocationShift;
+  }
+
+  representation_mask = descriptors->kRepresentationMask;
+  representation_shift = descriptors->kRepresentationShift;
+  representation_double = descriptors->kRepresentationDouble;
+  field_index_mask = descriptors->kPropertyIndexMask;
+  field_index_shift = descriptors->kPropertyIndexShift;
+
+  resolved = true;
+}
+
 }  // namespace constants
 }  // namespace v8
 }  // namespace llnode
@@ -1,6 +1,9 @@
 #ifndef SRC_LLV8_CONSTANTS_H_
 #define SRC_LLV8_CONSTANTS_H_
 
+#include <utility>
+#include <vector>
+
 #include <lldb/API/LLDB.h>
 
 #include "constants.h"
@@ -176,6 +179,7 @@ class Code : public Module {
 
   int64_t kStartOffset;
   int64_t kSizeOffset;
+  int64_t kCodeAlignment;
 
  protected:
   void Load();
@@ -308,6 +312,18 @@ class ThinString : public Module {
   void Load();
 };
 
+class ExternalString : public Module {
+ public:
+  CONSTANTS_DEFAULT_METHODS(ExternalString);
+
+  int64_t kResourceOffset;
+  int64_t kResourceDataOffset;
+  int64_t kUncachedMask;
+
+ protected:
+  void Load();
+};
+
 class FixedArrayBase : public Module {
  public:
   CONSTANTS_DEFAULT_METHODS(FixedArrayBase);
@@ -334,6 +350,51 @@ class FixedTypedArrayBase : public Module {
 
   int64_t kBasePointerOffset;
   int64_t kExternalPointerOffset;
+  int64_t kDataOffset;
+
+ protected:
+  void Load();
+};
+
+class PropertyArray : public Module {
+ public:
+  CONSTANTS_DEFAULT_METHODS(PropertyArray);
+
+  int64_t kLengthAndHashOffset;
+  int64_t kLengthMask;
+  int64_t kHeaderSize;
+
+ protected:
+  void Load();
+};
+
+class WeakArrayList : public Module {
+ public:
+  CONSTANTS_DEFAULT_METHODS(WeakArrayList);
+
+  int64_t kCapacityOffset;
+  int64_t kHeaderSize;
+
+ protected:
+  void Load();
+};
+
+class BytecodeArray : public Module {
+ public:
+  CONSTANTS_DEFAULT_METHODS(BytecodeArray);
+
+  int64_t kHeaderSize;
+
+ protected:
+  void Load();
+};
+
+class FeedbackVector : public Module {
+ public:
+  CONSTANTS_DEFAULT_METHODS(FeedbackVector);
+
+  int64_t kLengthOffset;
+  int64_t kHeaderSize;
 
  protected:
   void Load();
@@ -478,6 +539,25 @@ class Symbol : public Module {
   void Load();
 };
 
+class MemoryChunk : public Module {
+ public:
+  CONSTANTS_DEFAULT_METHODS(MemoryChunk);
+
+  int64_t kAlignment;
+
+  int64_t kSizeOffset;
+  int64_t kFlagsOffset;
+  int64_t kAreaStartOffset;
+  int64_t kAreaEndOffset;
+
+  int64_t kIsExecutableFlag;
+  int64_t kInFromSpaceFlag;
+  int64_t kInToSpaceFlag;
+
+ protected:
+  void Load();
+};
+
 class Types : public Module {
  public:
   CONSTANTS_DEFAULT_METHODS(Types);
@@ -501,6 +581,9 @@ class Types : public Module {
   int64_t kCodeType;
   int64_t kJSFunctionType;
   int64_t kFixedArrayType;
+  int64_t kFixedDoubleArrayType;
+  int64_t kByteArrayType;
+  int64_t kFreeSpaceType;
   int64_t kJSArrayBufferType;
   int64_t kJSTypedArrayType;
   int64_t kJSRegExpType;
@@ -510,9 +593,88 @@ class Types : public Module {
   int64_t kScopeInfoType;
   int64_t kSymbolType;
 
-
- protected:
-  void Load();
+  // Variable sized types, -1 for the ones a version doesn't have
+  int64_t kFirstFixedArrayType;
+  int64_t kLastFixedArrayType;
+  int64_t kFirstFixedTypedArrayType;
+  int64_t kLastFixedTypedArrayType;
+  int64_t kWeakFixedArrayType;
+  int64_t kWeakArrayListType;
+  int64_t kPropertyArrayType;
+  int64_t kBytecodeArrayType;
+  int64_t kDescriptorArrayType;
+  int64_t kFeedbackVectorType;
+
+  // True if objects of `type` are laid out like a FixedArray, a length
+  // followed by as many pointer sized slots
+  bool IsFixedArrayLayout(int64_t type) const;
+
+  // Size of the elements of fixed typed arrays of `type`
+  int64_t FixedTypedArrayElementSize(int64_t type) const;
+
+ protected:
+  void Load();
+
+ private:
+  // Types laid out like a FixedArray outside of the ranges above
+  std::vector<int64_t> fixed_array_types_;
+  // Fixed typed array types and the size of their elements
+  std::vector<std::pair<int64_t, int64_t>> fixed_typed_array_types_;
+};
+
+/* The constants read for every object and property visited, with the
+ * differences between V8 versions settled once. Offsets come from the debug
+ * symbols of each binary rather than from its V8 version, so they can't be
+ * compile-time constants, but resolving them into plain fields spares hot
+ * accessors the lazy load check of every module and the version branches.
+ */
+struct Layout {
+  bool resolved = false;
+
+  int64_t pointer_size;
+
+  int64_t smi_tag;
+  int64_t smi_tag_mask;
+  int64_t smi_shift;
+
+  int64_t heap_object_tag;
+  int64_t heap_object_tag_mask;
+  int64_t map_offset;
+
+  int64_t map_type_offset;
+  int64_t map_type_mask;
+  int64_t instance_descriptors_offset;
+  int64_t bit_field3_offset;
+  int64_t dictionary_map_bit;
+  int64_t own_descriptors_mask;
+  int64_t own_descriptors_shift;
+
+  int64_t fixed_array_data_offset;
+
+  // Offsets of the key, details and value of a descriptor, in words from
+  // the start of the descriptor array
+  int64_t descriptor_first_index;
+  int64_t descriptor_size;
+  int64_t descriptor_key_offset;
+  int64_t descriptor_details_offset;
+  int64_t descriptor_value_offset;
+
+  // Property details are told apart by their location on node.js >= 8 and
+  // by their type before, `details & details_mask` is compared to these.
+  // Kinds a version doesn't have are -1 and never match.
+  int64_t details_mask;
+  int64_t field_details;
+  int64_t const_field_details;
+  int64_t descriptor_details;
+
+  int64_t representation_mask;
+  int64_t representation_shift;
+  int64_t representation_double;
+  int64_t field_index_mask;
+  int64_t field_index_shift;
+
+  void Resolve(Common* common, Smi* smi, HeapObject* heap_obj, Map* map,
+               FixedArray* fixed_array, DescriptorArray* descriptor_array);
 };
 
 }  // namespace constants
@@ -31,22 +31,24 @@ inline T LLV8::LoadValue(int64_t addr, Error& err) {
 
 
 inline bool Smi::Check() const {
-  return (raw() & v8()->smi()->kTagMask) == v8()->smi()->kTag;
+  const constants::Layout& layout = v8()->layout();
+  return (raw() & layout.smi_tag_mask) == layout.smi_tag;
 }
 
 
 inline int64_t Smi::GetValue() const {
-  return raw() >> (v8()->smi()->kShiftSize + v8()->smi()->kTagMask);
+  return raw() >> v8()->layout().smi_shift;
 }
 
 
 inline bool HeapObject::Check() const {
-  return (raw() & v8()->heap_obj()->kTagMask) == v8()->heap_obj()->kTag;
+  const constants::Layout& layout = v8()->layout();
+  return (raw() & layout.heap_object_tag_mask) == layout.heap_object_tag;
 }
 
 
 int64_t HeapObject::LeaField(int64_t off) const {
-  return raw() - v8()->heap_obj()->kTag + off;
+  return raw() - v8()->layout().heap_object_tag + off;
 }
 
 
@@ -100,11 +102,11 @@ inline bool HeapObject::IsJSErrorType(Error& err) {
 
 
 inline int64_t Map::GetType(Error& err) {
-  int64_t type =
-      v8()->LoadUnsigned(LeaField(v8()->map()->kInstanceAttrsOffset), 2, err);
+  const constants::Layout& layout = v8()->layout();
+  int64_t type = v8()->LoadUnsigned(LeaField(layout.map_type_offset), 2, err);
   if (err.Fail()) return -1;
 
-  return type & v8()->map()->kMapTypeMask;
+  return type & layout.map_type_mask;
 }
 
 
@@ -143,7 +145,7 @@ inline bool Map::IsDictionary(Error& err) {
   int64_t field = BitField3(err);
   if (err.Fail()) return false;
 
-  return (field & (1 << v8()->map()->kDictionaryMapShift)) != 0;
+  return (field & v8()->layout().dictionary_map_bit) != 0;
 }
 
 
@@ -152,9 +154,8 @@ inline int64_t Map::NumberOfOwnDescriptors(Error& err) {
   if (err.Fail()) return false;
 
   // Skip EnumLength
-  field &= v8()->map()->kNumberOfOwnDescriptorsMask;
-  field >>= v8()->map()->kNumberOfOwnDescriptorsShift;
-  return field;
+  const constants::Layout& layout = v8()->layout();
+  return (field & layout.own_descriptors_mask) >> layout.own_descriptors_shift;
 }
 
 
@@ -164,16 +165,17 @@ inline int64_t Map::NumberOfOwnDescriptors(Error& err) {
   }
 
 
-ACCESSOR(HeapObject, GetMap, heap_obj()->kMapOffset, HeapObject)
+ACCESSOR(HeapObject, GetMap, layout().map_offset, HeapObject)
 
 ACCESSOR(Map, MaybeConstructor, map()->kMaybeConstructorOffset, HeapObject)
-ACCESSOR(Map, InstanceDescriptors, map()->kInstanceDescriptorsOffset,
+ACCESSOR(Map, InstanceDescriptors, layout().instance_descriptors_offset,
          HeapObject)
 
 ACCESSOR(Symbol, Name, symbol()->kNameOffset, HeapObject)
 
 inline int64_t Map::BitField3(Error& err) {
-  return v8()->LoadUnsigned(LeaField(v8()->map()->kBitField3Offset), 4, err);
+  return v8()->LoadUnsigned(LeaField(v8()->layout().bit_field3_offset), 4,
+                            err);
 }
 
 inline int64_t Map::InstanceType(Error& err) {
@@ -435,144 +437,179 @@ inline std::string TwoByteString::ToString(Error& err, bool utf16) {
 }
 
 inline std::string ConsString::ToString(Error& err, bool utf16) {
-  String first = First(err);
-  if (err.Fail()) return std::string();
-
-  String second = Second(err);
-  if (err.Fail()) return std::string();
-
-  std::string tmp = first.ToString(err, utf16);
-  if (err.Fail()) return std::string();
-  tmp += second.ToString(err, utf16);
-  if (err.Fail()) return std::string();
-
-  return tmp;
+  return Flatten(-1, utf16, err);
 }
 
 inline std::string SlicedString::ToString(Error& err, bool utf16) {
-  String parent = Parent(err);
-  if (err.Fail()) return std::string();
+  return Flatten(-1, utf16, err);
+}
 
-  // TODO - Remove when we add support for external strings
-  // We can't use the offset and length safely if we get "(external)"
-  // instead of the original parent string.
-  if (parent.Representation(err) == v8()->string()->kExternalStringTag) {
-    return parent.ToString(err, utf16);
+inline std::string ThinString::ToString(Error& err, bool utf16) {
+  return Flatten(-1, utf16, err);
+}
+
+inline int64_t ExternalString::ResourceData(Error& err) {
+  if (v8()->external_string()->kResourceOffset == -1) {
+    err = Error::Ok();
+    return -1;
   }
 
-  Smi offset = Offset(err);
-  if (err.Fail()) return std::string();
+  int64_t type = GetType(err);
+  if (err.Fail()) return -1;
 
-  Smi length = Length(err);
-  if (err.Fail()) return std::string();
+  if ((type & v8()->external_string()->kUncachedMask) == 0)
+    return LoadField(v8()->external_string()->kResourceDataOffset, err);
 
-  std::string tmp = parent.ToString(err, utf16);
-  if (err.Fail()) return std::string();
+  // Uncached, the data pointer is somewhere in the embedder's resource, whose
+  // layout isn't known (Node's own resources keep their isolate first)
+  return -1;
+}
 
-  int64_t off = offset.GetValue();
-  int64_t len = length.GetValue();
-  int64_t tmp_size = tmp.size();
-  if (off > tmp_size || len > tmp_size) {
-    err = Error::Failure("Failed to display sliced string 0x%016" PRIx64
-                         " (offset = 0x%016" PRIx64 ", length = 0x%016" PRIx64
-                         ") from parent string 0x%016" PRIx64
-                         " (length = 0x%016" PRIx64 ")",
-                         raw(), off, len, parent.raw(), tmp_size);
-    return std::string();
-  }
-  return tmp.substr(off, len);
+inline int64_t FixedArray::LeaData() const {
+  return LeaField(v8()->layout().fixed_array_data_offset);
 }
 
-inline std::string ThinString::ToString(Error& err, bool utf16) {
-  String actual = Actual(err);
-  if (err.Fail()) return std::string();
+inline bool FieldSnapshot::Contains(int64_t off, int64_t size) const {
+  return off >= start_ &&
+         off + size <= start_ + static_cast<int64_t>(data_.size());
+}
 
-  std::string tmp = actual.ToString(err, utf16);
-  if (err.Fail()) return std::string();
+template <>
+inline double FieldSnapshot::Get<double>(int64_t off, Error& err) {
+  if (!Contains(off, sizeof(double)))
+    return obj_.LoadFieldValue<double>(off, err);
 
-  return tmp;
+  int64_t bits =
+      obj_.v8()->DecodeUnsigned(&data_[off - start_], sizeof(double));
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  err = Error::Ok();
+  return value;
 }
 
-inline int64_t FixedArray::LeaData() const {
-  return LeaField(v8()->fixed_array()->kDataOffset);
+template <class T>
+inline T FieldSnapshot::Get(int64_t off, Error& err) {
+  uint32_t pointer_size = obj_.v8()->address_byte_size_;
+  if (!Contains(off, pointer_size)) return obj_.LoadFieldValue<T>(off, err);
+
+  T res(obj_.v8(),
+        obj_.v8()->DecodeUnsigned(&data_[off - start_], pointer_size));
+  if (!res.Check()) {
+    err = Error::Failure("Invalid field value %s at 0x%016" PRIx64,
+                         T::ClassName(), off);
+    return T();
+  }
+
+  err = Error::Ok();
+  return res;
 }
 
 template <class T>
 inline T FixedArray::Get(int index, Error& err) {
-  int64_t off =
-      v8()->fixed_array()->kDataOffset + index * v8()->common()->kPointerSize;
+  const constants::Layout& layout = v8()->layout();
+  int64_t off = layout.fixed_array_data_offset + index * layout.pointer_size;
   return LoadFieldValue<T>(off, err);
 }
 
+template <class T>
+inline T FixedArray::Get(FieldSnapshot& slots, int index, Error& err) {
+  const constants::Layout& layout = v8()->layout();
+  int64_t off = layout.fixed_array_data_offset + index * layout.pointer_size;
+  return slots.Get<T>(off, err);
+}
+
+inline FieldSnapshot FixedArray::Snapshot(int64_t length) {
+  const constants::Layout& layout = v8()->layout();
+  return FieldSnapshot(
+      *this, layout.fixed_array_data_offset + length * layout.pointer_size);
+}
+
+inline FieldSnapshot FixedArray::Snapshot(int64_t start, int64_t end) {
+  const constants::Layout& layout = v8()->layout();
+  return FieldSnapshot(
+      *this, layout.fixed_array_data_offset + start * layout.pointer_size,
+      layout.fixed_array_data_offset + end * layout.pointer_size);
+}
+
+inline int64_t DescriptorArray::SlotIndex(int64_t index, int64_t offset) {
+  const constants::Layout& layout = v8()->layout();
+  return layout.descriptor_first_index + index * layout.descriptor_size +
+         offset;
+}
+
 inline Smi DescriptorArray::GetDetails(int index, Error& err) {
-  return Get<Smi>(v8()->descriptor_array()->kFirstIndex +
-                      index * v8()->descriptor_array()->kSize +
-                      v8()->descriptor_array()->kDetailsOffset,
+  return Get<Smi>(SlotIndex(index, v8()->layout().descriptor_details_offset),
                   err);
 }
 
 inline Value DescriptorArray::GetKey(int index, Error& err) {
-  return Get<Value>(v8()->descriptor_array()->kFirstIndex +
-                        index * v8()->descriptor_array()->kSize +
-                        v8()->descriptor_array()->kKeyOffset,
+  return Get<Value>(SlotIndex(index, v8()->layout().descriptor_key_offset),
                     err);
 }
 
 inline Value DescriptorArray::GetValue(int index, Error& err) {
-  return Get<Value>(v8()->descriptor_array()->kFirstIndex +
-                        index * v8()->descriptor_array()->kSize +
-                        v8()->descriptor_array()->kValueOffset,
+  return Get<Value>(SlotIndex(index, v8()->layout().descriptor_value_offset),
                     err);
 }
 
-inline bool DescriptorArray::IsDescriptorDetails(Smi details) {
-  // node.js <= 7
-  if (v8()->descriptor_array()->kPropertyTypeMask != -1) {
-    return false;
-  }
+inline FieldSnapshot DescriptorArray::Snapshot(int64_t count) {
+  return FixedArray::Snapshot(SlotIndex(count, 0));
+}
 
-  // node.js >= 8
-  return (details.GetValue() &
-          v8()->descriptor_array()->kPropertyLocationMask) ==
-         (v8()->descriptor_array()->kPropertyLocationEnum_kDescriptor
-          << v8()->descriptor_array()->kPropertyLocationShift);
+inline Smi DescriptorArray::GetDetails(FieldSnapshot& descriptors, int index,
+                                       Error& err) {
+  return Get<Smi>(descriptors,
+                  SlotIndex(index, v8()->layout().descriptor_details_offset),
+                  err);
 }
-inline bool DescriptorArray::IsFieldDetails(Smi details) {
-  // node.js <= 7
-  if (v8()->descriptor_array()->kPropertyTypeMask != -1) {
-    return (details.GetValue() & v8()->descriptor_array()->kPropertyTypeMask) ==
-           v8()->descriptor_array()->kFieldType;
-  }
 
-  // node.js >= 8
-  return (details.GetValue() &
-          v8()->descriptor_array()->kPropertyLocationMask) ==
-         (v8()->descriptor_array()->kPropertyLocationEnum_kField
-          << v8()->descriptor_array()->kPropertyLocationShift);
+inline Value DescriptorArray::GetKey(FieldSnapshot& descriptors, int index,
+                                     Error& err) {
+  return Get<Value>(descriptors,
+                    SlotIndex(index, v8()->layout().descriptor_key_offset),
+                    err);
 }
 
-inline bool DescriptorArray::IsConstFieldDetails(Smi details) {
-  // node.js <= 7
-  if (v8()->descriptor_array()->kPropertyTypeMask != -1) {
-    return (details.GetValue() & v8()->descriptor_array()->kPropertyTypeMask) ==
-           v8()->descriptor_array()->kConstFieldType;
-  }
+inline Value DescriptorArray::GetValue(FieldSnapshot& descriptors, int index,
+                                       Error& err) {
+  return Get<Value>(descriptors,
+                    SlotIndex(index, v8()->layout().descriptor_value_offset),
+                    err);
+}
 
-  // node.js >= 8
-  return false;
+
+// Always false on node.js <= 7
+inline bool DescriptorArray::IsDescriptorDetails(Smi details) {
+  const constants::Layout& layout = v8()->layout();
+  return (details.GetValue() & layout.details_mask) ==
+         layout.descriptor_details;
+}
+
+inline bool DescriptorArray::IsFieldDetails(Smi details) {
+  const constants::Layout& layout = v8()->layout();
+  return (details.GetValue() & layout.details_mask) == layout.field_details;
+}
+
+// Always false on node.js >= 8
+inline bool DescriptorArray::IsConstFieldDetails(Smi details) {
+  const constants::Layout& layout = v8()->layout();
+  return (details.GetValue() & layout.details_mask) ==
+         layout.const_field_details;
 }
 
 inline bool DescriptorArray::IsDoubleField(Smi details) {
+  const constants::Layout& layout = v8()->layout();
   int64_t repr = details.GetValue();
-  repr &= v8()->descriptor_array()->kRepresentationMask;
-  repr >>= v8()->descriptor_array()->kRepresentationShift;
+  repr &= layout.representation_mask;
+  repr >>= layout.representation_shift;
 
-  return repr == v8()->descriptor_array()->kRepresentationDouble;
+  return repr == layout.representation_double;
 }
 
 inline int64_t DescriptorArray::FieldIndex(Smi details) {
-  return (details.GetValue() & v8()->descriptor_array()->kPropertyIndexMask) >>
-         v8()->descriptor_array()->kPropertyIndexShift;
+  const constants::Layout& layout = v8()->layout();
+  return (details.GetValue() & layout.field_index_mask) >>
+         layout.field_index_shift;
 }
 
 inline Value NameDictionary::GetKey(int index, Error& err) {
@@ -715,6 +752,26 @@ inline bool JSArrayBuffer::WasNeutered(Error& err) {
   return field != 0;
 }
 
+inline int64_t MemoryChunk::Alignment(LLV8* v8) {
+  return v8->memory_chunk()->kAlignment;
+}
+
+inline int64_t MemoryChunk::Size(Error& err) {
+  return v8()->LoadPtr(raw() + v8()->memory_chunk()->kSizeOffset, err);
+}
+
+inline int64_t MemoryChunk::Flags(Error& err) {
+  return v8()->LoadPtr(raw() + v8()->memory_chunk()->kFlagsOffset, err);
+}
+
+inline int64_t MemoryChunk::AreaStart(Error& err) {
+  return v8()->LoadPtr(raw() + v8()->memory_chunk()->kAreaStartOffset, err);
+}
+
+inline int64_t MemoryChunk::AreaEnd(Error& err) {
+  return v8()->LoadPtr(raw() + v8()->memory_chunk()->kAreaEndOffset, err);
+}
+
 #undef ACCESSOR
 
 }  // namespace v8
@@ -3,10 +3,13 @@
 #include <algorithm>
 #include <cinttypes>
 #include <cstdarg>
+#include <cstdlib>
+#include <cstring>
 
 #include "llnode-api.h"
 #include "llv8-inl.h"
 #include "llv8.h"
+#include "src/utf.h"
 
 namespace llnode {
 namespace v8 {
@@ -20,12 +23,29 @@ static std::string kConstantPrefix = "v8dbg_";
 void LLV8::Load(SBTarget target) {
   // Reload process anyway
   process_ = target.GetProcess();
+  address_byte_size_ = process_.GetAddressByteSize();
+  byte_order_ = process_.GetByteOrder();
+
+  // Drops cached pages if the process has changed or resumed, along with
+  // everything decoded from them
+  if (cache_.SetProcess(process_)) {
+    script_sources_.clear();
+    map_descriptors_.clear();
+  }
 
   // No need to reload
   if (target_ == target) return;
 
   target_ = target;
 
+  OpenCore();
+
+  // Page cache budget in megabytes, 0 disables it
+  const char* cache_size = getenv("LLNODE_CACHE_SIZE");
+  if (cache_size != nullptr && *cache_size != '\0') {
+    cache_.SetBudget(strtoull(cache_size, nullptr, 10) * 1024 * 1024);
+  }
+
   common.Assign(target);
   smi.Assign(target, &common);
   heap_obj.Assign(target, &common);
@@ -45,9 +65,14 @@ void LLV8::Load(SBTarget target) {
   cons_string.Assign(target, &common);
   sliced_string.Assign(target, &common);
   thin_string.Assign(target, &common);
+  external_string.Assign(target, &common);
   fixed_array_base.Assign(target, &common);
   fixed_array.Assign(target, &common);
   fixed_typed_array_base.Assign(target, &common);
+  property_array.Assign(target, &common);
+  weak_array_list.Assign(target, &common);
+  bytecode_array.Assign(target, &common);
+  feedback_vector.Assign(target, &common);
   oddball.Assign(target, &common);
   js_array_buffer.Assign(target, &common);
   js_array_buffer_view.Assign(target, &common);
@@ -57,14 +82,125 @@ void LLV8::Load(SBTarget target) {
   name_dictionary.Assign(target, &common);
   frame.Assign(target, &common);
   symbol.Assign(target, &common);
+  memory_chunk.Assign(target, &common);
   types.Assign(target, &common);
+  layout_ = constants::Layout();
 }
 
-int64_t LLV8::LoadPtr(int64_t addr, Error& err) {
+void LLV8::PreloadConstants() {
+  common();
+  smi();
+  heap_obj();
+  map();
+  js_object();
+  heap_number();
+  js_array();
+  js_function();
+  shared_info();
+  code();
+  scope_info();
+  context();
+  script();
+  string();
+  one_byte_string();
+  two_byte_string();
+  cons_string();
+  sliced_string();
+  thin_string();
+  external_string();
+  fixed_array_base();
+  fixed_array();
+  fixed_typed_array_base();
+  property_array();
+  weak_array_list();
+  bytecode_array();
+  feedback_vector();
+  oddball();
+  js_array_buffer();
+  js_array_buffer_view();
+  js_regexp();
+  js_date();
+  descriptor_array();
+  name_dictionary();
+  frame();
+  symbol();
+  memory_chunk();
+  types();
+  layout();
+}
+
+
+void LLV8::OpenCore() {
+  core_.Close();
+
+  std::string path = core_path_;
+  if (path.empty()) {
+    const char* env = getenv("LLNODE_COREFILE");
+    if (env != nullptr) path = env;
+  }
+  if (path.empty()) return;
+
+  // Live processes must always be read through LLDB
+  const char* plugin = process_.GetPluginName();
+  if (plugin == nullptr || strstr(plugin, "core") == nullptr) return;
+
+  Error err;
+  if (!core_.Open(path.c_str(), err)) {
+    Error::PrintInDebugMode("%s", err.GetMessage());
+    return;
+  }
+
+  // Make sure the file really is the core LLDB has loaded by comparing the
+  // first word of the first segment it contains.
+  for (const CoreMemoryReader::Segment& segment : core_.segments()) {
+    if (segment.available() < address_byte_size_) continue;
+
+    uint8_t expected[8];
+    uint8_t actual[8];
+    SBError sberr;
+    process_.ReadMemory(static_cast<addr_t>(segment.start()), actual,
+                        address_byte_size_, sberr);
+    if (core_.address_byte_size() != address_byte_size_ || sberr.Fail() ||
+        !core_.Read(segment.start(), expected, address_byte_size_) ||
+        memcmp(expected, actual, address_byte_size_) != 0) {
+      Error::PrintInDebugMode("Core file '%s' doesn't match the process",
+                              path.c_str());
+      core_.Close();
+    }
+    return;
+  }
+}
+
+
+bool LLV8::ReadMemory(int64_t addr, void* buf, size_t size) {
+  if (core_.Read(static_cast<uint64_t>(addr), buf, size)) return true;
+
+  std::lock_guard<std::mutex> lock(memory_mutex_);
+
+  if (cache_.enabled() && size <= MemoryCache::kMaxCachedRead)
+    return cache_.Read(static_cast<uint64_t>(addr), buf, size);
+
   SBError sberr;
-  int64_t value =
-      process_.ReadPointerFromMemory(static_cast<addr_t>(addr), sberr);
-  if (sberr.Fail()) {
+  size_t loaded =
+      process_.ReadMemory(static_cast<addr_t>(addr), buf, size, sberr);
+  return !sberr.Fail() && loaded == size;
+}
+
+
+int64_t LLV8::DecodeUnsigned(const uint8_t* buf, uint32_t byte_size) {
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < byte_size; i++) {
+    uint32_t index = byte_order_ == lldb::eByteOrderBig ? i : byte_size - i - 1;
+    value = (value << 8) | buf[index];
+  }
+  return static_cast<int64_t>(value);
+}
+
+
+int64_t LLV8::LoadPtr(int64_t addr, Error& err) {
+  uint8_t buf[8];
+  if (address_byte_size_ > sizeof(buf) ||
+      !ReadMemory(addr, buf, address_byte_size_)) {
     // TODO(joyeecheung): use Error::Failure() to report information when
     // there is less noise from here.
     err = Error(true, "Failed to load pointer from v8 memory");
@@ -72,16 +208,13 @@ int64_t LLV8::LoadPtr(int64_t addr, Error& err) {
   }
 
   err = Error::Ok();
-  return value;
+  return DecodeUnsigned(buf, address_byte_size_);
 }
 
 
 int64_t LLV8::LoadUnsigned(int64_t addr, uint32_t byte_size, Error& err) {
-  SBError sberr;
-  int64_t value = process_.ReadUnsignedFromMemory(static_cast<addr_t>(addr),
-                                                  byte_size, sberr);
-
-  if (sberr.Fail()) {
+  uint8_t buf[8];
+  if (byte_size > sizeof(buf) || !ReadMemory(addr, buf, byte_size)) {
     // TODO(joyeecheung): use Error::Failure() to report information when
     // there is less noise from here.
     err = Error(true, "Failed to load unsigned from v8 memory");
@@ -89,15 +222,13 @@ int64_t LLV8::LoadUnsigned(int64_t addr, uint32_t byte_size, Error& err) {
   }
 
   err = Error::Ok();
-  return value;
+  return DecodeUnsigned(buf, byte_size);
 }
 
 
 double LLV8::LoadDouble(int64_t addr, Error& err) {
-  SBError sberr;
-  int64_t value = process_.ReadUnsignedFromMemory(static_cast<addr_t>(addr),
-                                                  sizeof(double), sberr);
-  if (sberr.Fail()) {
+  uint8_t buf[sizeof(double)];
+  if (!ReadMemory(addr, buf, sizeof(buf))) {
     err = Error::Failure(
         "Failed to load double from v8 memory, "
         "addr=0x%016" PRIx64,
@@ -106,15 +237,16 @@ double LLV8::LoadDouble(int64_t addr, Error& err) {
   }
 
   err = Error::Ok();
-  return *reinterpret_cast<double*>(&value);
+  int64_t bits = DecodeUnsigned(buf, sizeof(buf));
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
 }
 
 
 std::string LLV8::LoadBytes(int64_t addr, int64_t length, Error& err) {
   uint8_t* buf = new uint8_t[length + 1];
-  SBError sberr;
-  process_.ReadMemory(addr, buf, static_cast<size_t>(length), sberr);
-  if (sberr.Fail()) {
+  if (!ReadMemory(addr, buf, static_cast<size_t>(length))) {
     err = Error::Failure(
         "Failed to load v8 backing store memory, "
         "addr=0x%016" PRIx64 ", length=%" PRId64,
@@ -136,9 +268,7 @@ std::string LLV8::LoadBytes(int64_t addr, int64_t length, Error& err) {
 std::string* LLV8::LoadBytesX(int64_t addr, int64_t length, int64_t start,
                               int64_t end, Error& err) {
   uint8_t* buf = new uint8_t[length + 1];
-  SBError sberr;
-  process_.ReadMemory(addr, buf, static_cast<size_t>(length), sberr);
-  if (sberr.Fail()) {
+  if (!ReadMemory(addr, buf, static_cast<size_t>(length))) {
     err = Error::Failure(
         "Failed to load v8 backing store memory, "
         "addr=0x%016" PRIx64 ", length=%" PRId64,
@@ -164,10 +294,7 @@ std::string LLV8::LoadString(int64_t addr, int64_t length, Error& err) {
   }
 
   char* buf = new char[length + 1];
-  SBError sberr;
-  process_.ReadMemory(static_cast<addr_t>(addr), buf,
-                      static_cast<size_t>(length), sberr);
-  if (sberr.Fail()) {
+  if (!ReadMemory(addr, buf, static_cast<size_t>(length))) {
     err = Error::Failure(
         "Failed to load v8 one byte string memory, "
         "addr=0x%016" PRIx64 ", length=%" PRId64,
@@ -185,53 +312,17 @@ std::string LLV8::LoadString(int64_t addr, int64_t length, Error& err) {
 }
 
 std::string LLV8::Utf16ToUtf8(const std::u16string& u16_str) {
-  if (u16_str.empty()) {
-    return std::string();
-  }
   const char16_t* p = u16_str.data();
-  std::u16string::size_type len = u16_str.length();
-  if (p[0] == 0xFEFF) {
+  size_t len = u16_str.length();
+  if (len > 0 && p[0] == 0xFEFF) {
     // bom
     p += 1;
     len -= 1;
   }
 
-  std::string u8_str;
-  u8_str.reserve(len * 3);
-
-  char16_t u16_char;
-  for (std::u16string::size_type i = 0; i < len; ++i) {
-    u16_char = p[i];
-    if (u16_char < 0x0080) {
-      u8_str.push_back((char)(u16_char & 0x00FF));
-      continue;
-    }
-    if (u16_char >= 0x0080 && u16_char <= 0x07FF) {
-      u8_str.push_back((char)(((u16_char >> 6) & 0x1F) | 0xC0));
-      u8_str.push_back((char)((u16_char & 0x3F) | 0x80));
-      continue;
-    }
-    if (u16_char >= 0xD800 && u16_char <= 0xDBFF) {
-      uint32_t highSur = u16_char;
-      uint32_t lowSur = p[++i];
-      uint32_t codePoint = highSur - 0xD800;
-      codePoint <<= 10;
-      codePoint |= lowSur - 0xDC00;
-      codePoint += 0x10000;
-      u8_str.push_back((char)((codePoint >> 18) | 0xF0));
-      u8_str.push_back((char)(((codePoint >> 12) & 0x3F) | 0x80));
-      u8_str.push_back((char)(((codePoint >> 06) & 0x3F) | 0x80));
-      u8_str.push_back((char)((codePoint & 0x3F) | 0x80));
-      continue;
-    }
-    {
-      u8_str.push_back((char)(((u16_char >> 12) & 0x0F) | 0xE0));
-      u8_str.push_back((char)(((u16_char >> 6) & 0x3F) | 0x80));
-      u8_str.push_back((char)((u16_char & 0x3F) | 0x80));
-      continue;
-    }
-  }
-
+  std::string u8_str(MaxUtf8Length(len), '\0');
+  if (len == 0) return u8_str;
+  u8_str.resize(llnode::Utf16ToUtf8(p, len, &u8_str[0]));
   return u8_str;
 }
 
@@ -242,58 +333,34 @@ std::string LLV8::LoadTwoByteString(int64_t addr, int64_t length, Error& err,
     return std::string();
   }
 
-  // get source code / debug line needs origin utf16 string, although it
-  // will display wrong when the string contains characters that require
-  // two bytes to represented
-  if (utf16) {
-    char* buf = new char[2 * length + 1];
-    SBError sberr;
-    process_.ReadMemory(static_cast<addr_t>(addr), buf,
-                        static_cast<size_t>(length * 2), sberr);
-    if (sberr.Fail()) {
-      err = Error::Failure(
-          "Failed to load V8 two byte string memory, "
-          "addr=0x%016" PRIx64 ", length=%" PRId64,
-          addr, length);
-      delete[] buf;
-      return std::string();
-    }
-    for (int64_t i = 0; i < length; i++) buf[i] = buf[i * 2];
-    buf[length] = '\0';
-    std::string res = buf;
-    delete[] buf;
-    err = Error::Ok();
-    return res;
-  }
-
-  char16_t* buf = new char16_t[length];
-  SBError sberr;
-  process_.ReadMemory(static_cast<addr_t>(addr), buf,
-                      static_cast<size_t>(length * 2), sberr);
-  if (sberr.Fail()) {
+  std::u16string buf(length, u'\0');
+  if (length > 0 &&
+      !ReadMemory(addr, &buf[0], static_cast<size_t>(length * 2))) {
     err = Error::Failure(
         "Failed to load V8 two byte string memory, "
         "addr=0x%016" PRIx64 ", length=%" PRId64,
         addr, length);
-    delete[] buf;
-    return std::string();
-  }
-  std::string res = Utf16ToUtf8(buf);
-  delete[] buf;
-  if (err.Fail()) {
     return std::string();
   }
+
   err = Error::Ok();
-  return res;
+
+  // get source code / debug line needs origin utf16 string, although it
+  // will display wrong when the string contains characters that require
+  // two bytes to represented
+  if (utf16) {
+    std::string res(length, '\0');
+    if (length > 0) Utf16ToLowBytes(buf.data(), length, &res[0]);
+    return res;
+  }
+
+  return Utf16ToUtf8(buf);
 }
 
 
 uint8_t* LLV8::LoadChunk(int64_t addr, int64_t length, Error& err) {
   uint8_t* buf = new uint8_t[length];
-  SBError sberr;
-  process_.ReadMemory(static_cast<addr_t>(addr), buf,
-                      static_cast<size_t>(length), sberr);
-  if (sberr.Fail()) {
+  if (!ReadMemory(addr, buf, static_cast<size_t>(length))) {
     err = Error::Failure(
         "Failed to load V8 chunk memory, "
         "addr=0x%016" PRIx64 ", length=%" PRId64,
@@ -977,50 +1044,70 @@ std::string SharedFunctionInfo::ToString(Error& err) {
 }
 
 
-// return end_char+1, which may be less than line_limit if source
-// ends before end_inclusive
-void Script::GetLines(uint64_t start_line, std::string lines[],
-                      uint64_t line_limit, uint32_t& lines_found, Error& err) {
-  lines_found = 0;
+/* The source is read and split in lines once per Script, listings and
+ * position lookups of all the frames and functions of a script share it.
+ */
+const ScriptSource* Script::LoadSource(Error& err) {
+  auto it = v8()->script_sources_.find(raw());
+  if (it != v8()->script_sources_.end()) {
+    err = Error::Ok();
+    return &it->second;
+  }
 
   HeapObject source = Source(err);
-  if (err.Fail()) return;
+  if (err.Fail()) return nullptr;
 
   int64_t type = source.GetType(err);
-  if (err.Fail()) return;
+  if (err.Fail()) return nullptr;
 
   // No source
   if (type > v8()->types()->kFirstNonstringType) {
     err = Error::Failure("No source, source_type=%" PRId64, type);
-    return;
+    return nullptr;
   }
 
+  ScriptSource script_source;
   String str(source);
-  std::string source_str = str.ToString(err);
-  uint64_t limit = source_str.length();
-
-  uint64_t length = 0;
-  uint64_t line_i = 0;
-  uint64_t i = 0;
-  for (; i < limit && lines_found < line_limit; i++) {
-    // \r\n should ski adding a line and column on \r
-    if (source_str[i] == '\r' && i < limit - 1 && source_str[i + 1] == '\n') {
-      i++;
-    }
-    if (source_str[i] == '\n' || source_str[i] == '\r') {
-      if (line_i >= start_line) {
-        lines[lines_found] = std::string(source_str, i - length, length);
-        lines_found++;
-      }
-      line_i++;
-      length = 0;
-    } else {
-      length++;
-    }
+  script_source.source = str.ToString(err);
+  if (err.Fail()) return nullptr;
+
+  // Lines end with \n, \r or \r\n
+  const std::string& text = script_source.source;
+  script_source.line_starts.push_back(0);
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] != '\n' && text[i] != '\r') continue;
+    if (text[i] == '\r' && i + 1 < text.size() && text[i + 1] == '\n') i++;
+    script_source.line_starts.push_back(i + 1);
   }
-  if (line_i >= start_line && length != 0 && lines_found < line_limit) {
-    lines[lines_found] = std::string(source_str, limit - length, length);
-    lines_found++;
+
+  if (v8()->script_sources_.size() >= LLV8::kMaxScriptSources)
+    v8()->script_sources_.clear();
+  return &(v8()->script_sources_[raw()] = std::move(script_source));
+}
+
+
+void Script::GetLines(uint64_t start_line, std::string lines[],
+                      uint64_t line_limit, uint32_t& lines_found, Error& err) {
+  lines_found = 0;
+
+  const ScriptSource* script_source = LoadSource(err);
+  if (err.Fail()) return;
+
+  const std::string& text = script_source->source;
+  const std::vector<uint32_t>& starts = script_source->line_starts;
+  for (uint64_t line = start_line;
+       line < starts.size() && lines_found < line_limit; line++) {
+    uint64_t start = starts[line];
+    uint64_t end = text.size();
+    if (line + 1 < starts.size()) {
+      // Leave the line break out
+      end = starts[line + 1] - 1;
+      if (end > start && text[end] == '\n' && text[end - 1] == '\r') end--;
+    } else if (start == end) {
+      // Nothing after the last line break
+      break;
+    }
+    lines[lines_found++] = text.substr(start, end - start);
   }
 }
 
@@ -1030,33 +1117,24 @@ void Script::GetLineColumnFromPos(int64_t pos, int64_t& line, int64_t& column,
   line = 0;
   column = 0;
 
-  HeapObject source = Source(err);
-  if (err.Fail()) return;
-
-  int64_t type = source.GetType(err);
-  if (err.Fail()) return;
-
-  // No source
-  if (type > v8()->types()->kFirstNonstringType) {
+  const ScriptSource* script_source = LoadSource(err);
+  if (err.Fail()) {
     err = Error(true, "No source");
     return;
   }
 
-  String str(source);
-  std::string source_str = str.ToString(err);
-  int64_t limit = source_str.length();
+  int64_t limit = script_source->source.size();
   if (limit > pos) limit = pos;
+  if (limit < 0) return;
 
-  for (int64_t i = 0; i < limit; i++, column++) {
-    // \r\n should ski adding a line and column on \r
-    if (source_str[i] == '\r' && i < limit - 1 && source_str[i + 1] == '\n') {
-      i++;
-    }
-    if (source_str[i] == '\n' || source_str[i] == '\r') {
-      column = 0;
-      line++;
-    }
-  }
+  // The line of `pos` is the last one starting at or before it
+  const std::vector<uint32_t>& starts = script_source->line_starts;
+  line = std::upper_bound(starts.begin(), starts.end(),
+                          static_cast<uint64_t>(limit)) -
+         starts.begin() - 1;
+
+  // Columns after the first line count the line break, as they always have
+  column = limit - starts[line] + (line > 0 ? 1 : 0);
 }
 
 bool Value::IsHoleOrUndefined(Error& err) {
@@ -1510,6 +1588,191 @@ std::string Smi::ToString(Error& err) {
 }
 
 
+int64_t HeapObject::Size(Error& err) {
+  HeapObject map_obj = GetMap(err);
+  if (err.Fail()) return -1;
+
+  Map map(map_obj);
+  int64_t size = map.InstanceSize(err);
+  if (err.Fail()) return -1;
+
+  // Zero is V8's sentinel for objects whose size depends on their contents
+  if (size != 0) return size;
+
+  int64_t type = map.GetType(err);
+  if (err.Fail()) return -1;
+
+  int64_t pointer_size = v8()->common()->kPointerSize;
+  constants::Types* types = v8()->types();
+  if (type < types->kFirstNonstringType) {
+    String str(this);
+    int64_t repr = str.Representation(err);
+    if (err.Fail()) return -1;
+
+    int64_t length = str.Length(err).GetValue();
+    if (err.Fail()) return -1;
+
+    if (repr != v8()->string()->kSeqStringTag) {
+      err = Error::Failure("Unexpected variable sized string, type=%" PRId64,
+                           type);
+      return -1;
+    }
+
+    int64_t encoding = str.Encoding(err);
+    if (err.Fail()) return -1;
+
+    if (encoding == v8()->string()->kOneByteStringTag)
+      size = v8()->one_byte_string()->kCharsOffset + length;
+    else
+      size = v8()->two_byte_string()->kCharsOffset + length * 2;
+  } else if (types->IsFixedArrayLayout(type) ||
+             type == types->kFixedDoubleArrayType ||
+             type == types->kByteArrayType ||
+             type == types->kBytecodeArrayType) {
+    FixedArrayBase array(this);
+    int64_t length = array.Length(err).GetValue();
+    if (err.Fail()) return -1;
+
+    if (type == types->kFixedDoubleArrayType)
+      size = v8()->fixed_array()->kDataOffset + length * sizeof(double);
+    else if (type == types->kByteArrayType)
+      size = v8()->fixed_array()->kDataOffset + length;
+    else if (type == types->kBytecodeArrayType)
+      size = v8()->bytecode_array()->kHeaderSize + length;
+    else
+      size = v8()->fixed_array()->kDataOffset + length * pointer_size;
+  } else if (type >= types->kFirstFixedTypedArrayType &&
+             type <= types->kLastFixedTypedArrayType &&
+             types->FixedTypedArrayElementSize(type) != -1) {
+    FixedTypedArrayBase array(this);
+    int64_t length = array.Length(err).GetValue();
+    if (err.Fail()) return -1;
+    int64_t base = array.GetBase(err);
+    if (err.Fail()) return -1;
+
+    // Only on-heap typed arrays hold their elements
+    size = v8()->fixed_typed_array_base()->kDataOffset;
+    if (base != 0) size += length * types->FixedTypedArrayElementSize(type);
+  } else if (type == types->kPropertyArrayType) {
+    constants::PropertyArray* property_array = v8()->property_array();
+    int64_t length_and_hash =
+        LoadFieldValue<Smi>(property_array->kLengthAndHashOffset, err)
+            .GetValue();
+    if (err.Fail()) return -1;
+
+    int64_t length = length_and_hash & property_array->kLengthMask;
+    size = property_array->kHeaderSize + length * pointer_size;
+  } else if (type == types->kWeakArrayListType) {
+    constants::WeakArrayList* weak_array_list = v8()->weak_array_list();
+    int64_t capacity =
+        LoadFieldValue<Smi>(weak_array_list->kCapacityOffset, err).GetValue();
+    if (err.Fail()) return -1;
+
+    size = weak_array_list->kHeaderSize + capacity * pointer_size;
+  } else if (type == types->kFeedbackVectorType) {
+    constants::FeedbackVector* feedback_vector = v8()->feedback_vector();
+    int64_t length = v8()->LoadUnsigned(
+        LeaField(feedback_vector->kLengthOffset), 4, err);
+    if (err.Fail()) return -1;
+
+    size = feedback_vector->kHeaderSize + length * pointer_size;
+  } else if (type == types->kCodeType) {
+    Code code(this);
+    int64_t instruction_size = code.Size(err);
+    if (err.Fail()) return -1;
+
+    // The instructions are followed by padding up to the code alignment
+    int64_t alignment = v8()->code()->kCodeAlignment;
+    size = v8()->code()->kStartOffset +
+           ((instruction_size + pointer_size - 1) & ~(pointer_size - 1));
+    size = (size + alignment - 1) & ~(alignment - 1);
+  } else if (type == types->kFreeSpaceType) {
+    // FreeSpace keeps its size where FixedArrayBase keeps its length
+    size = LoadFieldValue<Smi>(v8()->fixed_array_base()->kLengthOffset, err)
+               .GetValue();
+    if (err.Fail()) return -1;
+  } else {
+    err = Error::Failure("Unknown size for object of type %" PRId64, type);
+    return -1;
+  }
+
+  if (size <= 0) {
+    err = Error::Failure("Invalid object size %" PRId64, size);
+    return -1;
+  }
+
+  // Objects are pointer aligned
+  return (size + pointer_size - 1) & ~(pointer_size - 1);
+}
+
+
+const char* MemoryChunk::SpaceName(Space space) {
+  switch (space) {
+    case kNewSpace:
+      return "new";
+    case kOldSpace:
+      return "old";
+    case kCodeSpace:
+      return "code";
+    case kMapSpace:
+      return "map";
+    case kLargeObjectSpace:
+      return "large_object";
+    default:
+      return "unknown";
+  }
+}
+
+
+bool MemoryChunk::Check(int64_t limit, Error& err) {
+  int64_t size = Size(err);
+  if (err.Fail()) return false;
+
+  // Chunks are made of whole OS pages
+  if (size < Alignment(v8()) || size % 4096 != 0 || size > limit - raw())
+    return false;
+
+  int64_t area_start = AreaStart(err);
+  if (err.Fail()) return false;
+  int64_t area_end = AreaEnd(err);
+  if (err.Fail()) return false;
+
+  // The header is followed by the object area, which ends within the chunk
+  int64_t pointer_size = v8()->common()->kPointerSize;
+  return area_start > raw() && area_start - raw() < Alignment(v8()) &&
+         area_start % pointer_size == 0 && area_start < area_end &&
+         area_end <= raw() + size;
+}
+
+
+MemoryChunk::Space MemoryChunk::GetSpace(Error& err) {
+  int64_t flags = Flags(err);
+  if (err.Fail()) return kUnknownSpace;
+
+  if (flags & (v8()->memory_chunk()->kInFromSpaceFlag |
+               v8()->memory_chunk()->kInToSpaceFlag))
+    return kNewSpace;
+
+  // Regular pages are either 256KB or 512KB, depending on the V8 version
+  int64_t size = Size(err);
+  if (err.Fail()) return kUnknownSpace;
+  if (size != Alignment(v8()) && size != 2 * Alignment(v8()))
+    return kLargeObjectSpace;
+
+  if (flags & v8()->memory_chunk()->kIsExecutableFlag) return kCodeSpace;
+
+  // Map space only holds maps
+  int64_t area_start = AreaStart(err);
+  if (err.Fail()) return kUnknownSpace;
+  HeapObject first(v8(), area_start + v8()->heap_obj()->kTag);
+  int64_t type = first.GetType(err);
+  if (err.Fail()) return kUnknownSpace;
+  if (type == v8()->types()->kMapType) return kMapSpace;
+
+  return kOldSpace;
+}
+
+
 /* Utility function to generate short type names for objects.
  */
 std::string HeapObject::GetTypeName(Error& err) {
@@ -1637,115 +1900,270 @@ std::string Symbol::ToString(Error& err) {
 }
 
 std::string String::ToString(Error& err, bool utf16) {
-  int64_t repr = Representation(err);
-  if (err.Fail()) return std::string();
+  return Flatten(-1, utf16, err);
+}
+
 
+std::string String::Flatten(int64_t max_length, bool utf16, Error& err) {
   int64_t encoding = Encoding(err);
   if (err.Fail()) return std::string();
 
-  if (repr == v8()->string()->kSeqStringTag) {
-    if (encoding == v8()->string()->kOneByteStringTag) {
-      OneByteString one(this);
-      return one.ToString(err);
-    } else if (encoding == v8()->string()->kTwoByteStringTag) {
-      TwoByteString two(this);
-      return two.ToString(err, utf16);
-    }
-
-    err = Error::Failure("Unsupported seq string encoding %" PRId64, encoding);
+  int64_t length = Length(err).GetValue();
+  if (err.Fail()) return std::string();
+  if (length < 0) {
+    err = Error::Failure("Invalid length %" PRId64 " of string 0x%016" PRIx64,
+                         length, raw());
     return std::string();
   }
+  // A prefix still walks down the whole left spine of a rope, so the pieces
+  // are bounded by the length of the whole string
+  int64_t full_length = length;
+  if (max_length >= 0 && max_length < length) length = max_length;
+
+  // A one byte string only points to one byte strings, it is copied as is.
+  // Otherwise every character is copied in a UTF-16 buffer converted at the
+  // end, unless `utf16` asks for one byte per character.
+  bool wide = encoding != v8()->string()->kOneByteStringTag && !utf16;
+  std::string bytes;
+  std::u16string units;
+  if (wide)
+    units.resize(length);
+  else
+    bytes.resize(length);
+
+  // `count` characters of `str`, starting at `offset`, go at `dest`
+  struct Piece {
+    String str;
+    int64_t offset;
+    int64_t dest;
+    int64_t count;
+  };
+  std::vector<Piece> stack;
+  stack.push_back(Piece{*this, 0, 0, length});
+
+  // Ropes from a corrupted heap may loop, a valid one has fewer pieces than
+  // characters, plus the sliced and thin strings on the way
+  int64_t steps = 4 * full_length + 16;
+  std::vector<char> one_byte;
+  std::vector<char16_t> two_byte;
+  while (!stack.empty()) {
+    Piece piece = stack.back();
+    stack.pop_back();
+    if (piece.count == 0) continue;
+
+    if (--steps < 0) {
+      err = Error::Failure("String 0x%016" PRIx64 " is corrupted", raw());
+      return std::string();
+    }
 
-  if (repr == v8()->string()->kConsStringTag) {
-    ConsString cons(this);
-    return cons.ToString(err, utf16);
-    ;
-  }
+    String str = piece.str;
+    int64_t repr = str.Representation(err);
+    if (err.Fail()) return std::string();
 
-  if (repr == v8()->string()->kSlicedStringTag) {
-    SlicedString sliced(this);
-    return sliced.ToString(err, utf16);
-  }
+    if (repr == v8()->string()->kConsStringTag) {
+      ConsString cons(str);
+      String first = cons.First(err);
+      if (err.Fail()) return std::string();
+      String second = cons.Second(err);
+      if (err.Fail()) return std::string();
+      int64_t first_length = first.Length(err).GetValue();
+      if (err.Fail()) return std::string();
 
-  // TODO(indutny): add support for external strings
-  if (repr == v8()->string()->kExternalStringTag) {
-    return std::string("(external)");
-  }
+      // The part of the piece in `first` is walked next, the rest later
+      int64_t in_first = 0;
+      if (piece.offset < first_length)
+        in_first = std::min(piece.count, first_length - piece.offset);
+      stack.push_back(
+          Piece{second, std::max<int64_t>(piece.offset - first_length, 0),
+                piece.dest + in_first, piece.count - in_first});
+      stack.push_back(Piece{first, piece.offset, piece.dest, in_first});
+      continue;
+    }
+
+    if (repr == v8()->string()->kSlicedStringTag) {
+      SlicedString sliced(str);
+      String parent = sliced.Parent(err);
+      if (err.Fail()) return std::string();
+      int64_t offset = sliced.Offset(err).GetValue();
+      if (err.Fail()) return std::string();
+      stack.push_back(
+          Piece{parent, piece.offset + offset, piece.dest, piece.count});
+      continue;
+    }
+
+    if (repr == v8()->string()->kThinStringTag) {
+      ThinString thin(str);
+      String actual = thin.Actual(err);
+      if (err.Fail()) return std::string();
+      stack.push_back(Piece{actual, piece.offset, piece.dest, piece.count});
+      continue;
+    }
+
+    // A sequential or external string, copy the characters
+    int64_t str_length = str.Length(err).GetValue();
+    if (err.Fail()) return std::string();
+    if (piece.offset < 0 || piece.offset + piece.count > str_length) {
+      err = Error::Failure("Failed to display string 0x%016" PRIx64
+                           " (offset = 0x%016" PRIx64 ", length = 0x%016" PRIx64
+                           ") from string 0x%016" PRIx64
+                           " (length = 0x%016" PRIx64 ")",
+                           raw(), piece.offset, piece.count, str.raw(),
+                           str_length);
+      return std::string();
+    }
+
+    int64_t str_encoding = str.Encoding(err);
+    if (err.Fail()) return std::string();
+    bool one_byte_chars = str_encoding == v8()->string()->kOneByteStringTag;
+    if (!one_byte_chars &&
+        str_encoding != v8()->string()->kTwoByteStringTag) {
+      err = Error::Failure("Unsupported string encoding %" PRId64,
+                           str_encoding);
+      return std::string();
+    }
+
+    int64_t chars;
+    if (repr == v8()->string()->kSeqStringTag) {
+      chars = one_byte_chars
+                  ? str.LeaField(v8()->one_byte_string()->kCharsOffset)
+                  : str.LeaField(v8()->two_byte_string()->kCharsOffset);
+    } else if (repr == v8()->string()->kExternalStringTag) {
+      // The characters live outside of the heap, in the embedder's resource
+      ExternalString external(str);
+      chars = external.ResourceData(err);
+      if (err.Fail()) return std::string();
+      if (chars == -1) return std::string("(external)");
+    } else {
+      err = Error::Failure("Unsupported string representation %" PRId64, repr);
+      return std::string();
+    }
 
-  if (repr == v8()->string()->kThinStringTag) {
-    ThinString thin(this);
-    return thin.ToString(err, utf16);
+    bool read;
+    size_t count = static_cast<size_t>(piece.count);
+    if (one_byte_chars) {
+      int64_t addr = chars + piece.offset;
+      if (wide) {
+        one_byte.resize(count);
+        read = v8()->ReadMemory(addr, one_byte.data(), count);
+        for (size_t i = 0; read && i < count; i++)
+          units[piece.dest + i] = static_cast<uint8_t>(one_byte[i]);
+      } else {
+        read = v8()->ReadMemory(addr, &bytes[piece.dest], count);
+      }
+    } else {
+      int64_t addr = chars + piece.offset * 2;
+      if (wide) {
+        read = v8()->ReadMemory(addr, &units[piece.dest], count * 2);
+      } else {
+        // Only the low byte of every character is kept
+        two_byte.resize(count);
+        read = v8()->ReadMemory(addr, two_byte.data(), count * 2);
+        if (read) Utf16ToLowBytes(two_byte.data(), count, &bytes[piece.dest]);
+      }
+    }
+
+    if (!read) {
+      err = Error::Failure(
+          "Failed to load V8 string memory, addr=0x%016" PRIx64
+          ", length=%" PRId64,
+          str.raw(), piece.count);
+      return std::string();
+    }
   }
 
-  err = Error::Failure("Unsupported string representation %" PRId64, repr);
-  return std::string();
+  err = Error::Ok();
+  if (!wide) return bytes;
+
+  // Don't leave half of a surrogate pair behind when cut short, a string
+  // ending in one keeps it
+  if (length < full_length && !units.empty() && units.back() >= 0xD800 &&
+      units.back() <= 0xDBFF)
+    units.pop_back();
+  return v8()->Utf16ToUtf8(units);
 }
 
 
 std::string String::Inspect(InspectOptions* options, Error& err) {
-  std::string val = ToString(err);
+  int64_t total_length = Length(err).GetValue();
   if (err.Fail()) return std::string();
 
+  // Only the characters shown are read
   unsigned int len = options->length;
-  int total_length = val.length();
-  if (len != 0 && val.length() > len) val = val.substr(0, len) + "...";
+  bool cut = len != 0 && total_length > len;
+  std::string val = Flatten(cut ? static_cast<int64_t>(len) : -1, true, err);
+  if (err.Fail()) return std::string();
+  if (cut) val += "...";
 
   return "<String \"" + val + "\", length=" + std::to_string(total_length) +
          ">";
 }
 
-unsigned long String::GetSubStr(unsigned long current, int limit,
-                                std::string val) {
-  unsigned long curt = current + limit;
-  int next = val[curt] - 0xFFFFFF00;
-  if (val.length() > curt + 1 && next < 192 && next > 127) {
-    return GetSubStr(current, limit + 1, val);
-  } else {
-    return limit;
-  }
+/* Byte offset in the UTF-8 `value` after `units` UTF-16 code units from
+ * byte `offset`. `units` is set to the code units actually skipped, one
+ * more if the last character is a surrogate pair, fewer at the end.
+ */
+static size_t SkipUtf16Units(const std::string& value, size_t offset,
+                             int64_t& units) {
+  int64_t skipped = 0;
+  while (offset < value.size() && skipped < units) {
+    uint8_t lead = static_cast<uint8_t>(value[offset]);
+    size_t bytes = lead < 0xc0 ? 1 : lead < 0xe0 ? 2 : lead < 0xf0 ? 3 : 4;
+    // Only characters outside the BMP take four bytes, and two code units
+    skipped += bytes == 4 ? 2 : 1;
+    offset = std::min(offset + bytes, value.size());
+  }
+  units = skipped;
+  return offset;
 }
 
+
 first_non_string_t* String::InspectX(InspectOptions* options, Error& err) {
-  std::string val = ToString(err, false);
+  int64_t total_length = Length(err).GetValue();
   if (err.Fail()) return nullptr;
+
   first_non_string_t* string = new first_non_string_t;
   string->type = kFirstNonstring;
   string->name = "String";
-  string->total_length = val.length();
+  string->total_length = total_length;
 
-  unsigned int len = options->length;
-  if (options->current > val.length() - 1) {
+  // Pages start at `current` and are `limit` long, the first page is
+  // `length` long. All of them are in UTF-16 code units, like the length.
+  int64_t start = 0;
+  int64_t count = options->length;
+  if (options->current != 0 && options->limit != 0) {
+    // Negative values may come through the addon's unsigned options
+    start = std::max(static_cast<int>(options->current), 0);
+    count = std::max(static_cast<int>(options->limit), 0);
+  }
+
+  if (start >= total_length) {
     string->end = true;
-    string->current = val.length();
-    val = "";
-  } else if (options->current != 0 && options->limit != 0) {
-    int option_current = options->current;
-    if (option_current < 0) option_current = 0;
-    int option_limit = options->limit;
-    if (option_limit < 0) option_limit = 0;
-    unsigned int next_current = option_current + option_limit;
-    if (val.length() > next_current) {
-      unsigned long limit = GetSubStr(option_current, option_limit, val);
-      val = val.substr(option_current, limit) + "...";
-      string->current = option_current + limit;
-      string->end = false;
-    } else {
-      string->current = val.length();
-      val = val.substr(options->current);
-      string->end = true;
-    }
-  } else {
-    if (len != 0 && val.length() > len) {
-      val = val.substr(0, len) + "...";
-      string->end = false;
-      string->current = len;
-    } else {
-      string->current = val.length();
-      string->end = true;
-    }
+    string->current = total_length;
+    return string;
   }
 
-  string->display_value = val;
+  // Only read up to the end of the page, and one more code unit so a
+  // surrogate pair across it isn't cut
+  int64_t needed = count != 0 ? start + count + 1 : -1;
+  std::string val = Flatten(needed, false, err);
+  if (err.Fail()) {
+    delete string;
+    return nullptr;
+  }
+
+  size_t begin = SkipUtf16Units(val, 0, start);
+  if (count == 0) {
+    string->display_value = val.substr(begin);
+    string->current = total_length;
+    string->end = true;
+    return string;
+  }
+
+  size_t stop = SkipUtf16Units(val, begin, count);
+  string->current = start + count;
+  string->end = string->current >= total_length;
+  string->display_value = val.substr(begin, stop - begin);
+  if (!string->end) string->display_value += "...";
   return string;
 }
 
@@ -1810,9 +2228,10 @@ fixed_array_t* FixedArray::InspectX(InspectOptions* options, Error& err) {
 std::string FixedArray::InspectContents(int length, Error& err) {
   std::string res;
   InspectOptions options;
+  FieldSnapshot slots = Snapshot(length);
 
   for (int i = 0; i < length; i++) {
-    Value value = Get<Value>(i, err);
+    Value value = Get<Value>(slots, i, err);
     if (err.Fail()) return std::string();
 
     if (!res.empty()) res += ",\n";
@@ -2445,6 +2864,68 @@ HeapObject Map::Constructor(Error& err) {
 }
 
 
+std::shared_ptr<const MapDescriptors> Map::Descriptors(Error& err) {
+  auto it = v8()->map_descriptors_.find(raw());
+  if (it != v8()->map_descriptors_.end()) {
+    err = Error::Ok();
+    return it->second;
+  }
+
+  HeapObject descriptors_obj = InstanceDescriptors(err);
+  if (err.Fail()) return nullptr;
+
+  DescriptorArray descriptors(descriptors_obj);
+  int64_t own_descriptors_count = NumberOfOwnDescriptors(err);
+  if (err.Fail()) return nullptr;
+  if (own_descriptors_count < 0) own_descriptors_count = 0;
+
+  std::shared_ptr<MapDescriptors> decoded(new MapDescriptors());
+  int64_t in_object_count = InObjectProperties(decoded->fields_error);
+  if (decoded->fields_error.Success())
+    decoded->instance_size = InstanceSize(decoded->fields_error);
+
+  FieldSnapshot descriptor_fields = descriptors.Snapshot(own_descriptors_count);
+  decoded->descriptors.resize(own_descriptors_count);
+  for (int64_t i = 0; i < own_descriptors_count; i++) {
+    MapDescriptors::Descriptor& descriptor = decoded->descriptors[i];
+
+    Smi details = descriptors.GetDetails(descriptor_fields, i, err);
+    if (err.Fail()) continue;
+
+    Value key = descriptors.GetKey(descriptor_fields, i, err);
+    if (err.Fail()) continue;
+
+    descriptor.valid = true;
+    descriptor.details = details.GetValue();
+    descriptor.key = key.raw();
+
+    Error name_err;
+    descriptor.name = key.ToString(name_err);
+    descriptor.has_name = name_err.Success();
+    if (descriptor.has_name) decoded->names.emplace(descriptor.name, i);
+
+    if (descriptors.IsConstFieldDetails(details) ||
+        descriptors.IsDescriptorDetails(details)) {
+      descriptor.kind = MapDescriptors::kConstant;
+      Value value = descriptors.GetValue(descriptor_fields, i, err);
+      descriptor.has_value = err.Success();
+      descriptor.value = value.raw();
+    } else {
+      if (descriptors.IsFieldDetails(details))
+        descriptor.kind = MapDescriptors::kField;
+      descriptor.is_double = descriptors.IsDoubleField(details);
+      descriptor.index = descriptors.FieldIndex(details) - in_object_count;
+    }
+  }
+
+  if (v8()->map_descriptors_.size() >= LLV8::kMaxMapDescriptors)
+    v8()->map_descriptors_.clear();
+  v8()->map_descriptors_[raw()] = decoded;
+  err = Error::Ok();
+  return decoded;
+}
+
+
 std::string JSObject::Inspect(InspectOptions* options, Error& err) {
   HeapObject map_obj = GetMap(err);
   if (err.Fail()) return std::string();
@@ -3001,12 +3482,13 @@ std::string JSObject::InspectElements(int64_t length, Error& err) {
   HeapObject elements_obj = Elements(err);
   if (err.Fail()) return std::string();
   FixedArray elements(elements_obj);
+  FieldSnapshot slots = elements.Snapshot(length);
 
   InspectOptions options;
 
   std::string res;
   for (int64_t i = 0; i < length; i++) {
-    Value value = elements.Get<Value>(i, err);
+    Value value = elements.Get<Value>(slots, i, err);
     if (err.Fail()) return std::string();
 
     bool is_hole = value.IsHole(err);
@@ -3041,13 +3523,14 @@ elements_t* JSObject::InspectElementsX(int64_t length, Error& err,
   int64_t end = length;
   if (limit != 0) end = current + limit;
   if (end >= length) end = length;
+  FieldSnapshot slots = elements.Snapshot(start, end);
   elements_t* elementstmp = new elements_t;
   inspect_t** element = new inspect_t*[end - start];
   elementstmp->length = static_cast<int>(end - start);
   elementstmp->elements = element;
   elementstmp->current = end;
   for (int64_t i = start; i < end; i++) {
-    Value value = elements.Get<Value>(i, err);
+    Value value = elements.Get<Value>(slots, i, err);
     if (err.Fail()) {
       delete elementstmp;
       return nullptr;
@@ -3207,57 +3690,53 @@ properties_t* JSObject::InspectDictionaryX(Error& err, int64_t current,
 
 
 std::string JSObject::InspectDescriptors(Map map, Error& err) {
-  HeapObject descriptors_obj = map.InstanceDescriptors(err);
-  if (err.Fail()) return std::string();
-
-  DescriptorArray descriptors(descriptors_obj);
-  int64_t own_descriptors_count = map.NumberOfOwnDescriptors(err);
-  if (err.Fail()) return std::string();
-
-  int64_t in_object_count = map.InObjectProperties(err);
+  std::shared_ptr<const MapDescriptors> descriptors = map.Descriptors(err);
   if (err.Fail()) return std::string();
 
-  int64_t instance_size = map.InstanceSize(err);
-  if (err.Fail()) return std::string();
+  if (descriptors->fields_error.Fail()) {
+    err = descriptors->fields_error;
+    return std::string();
+  }
+  int64_t instance_size = descriptors->instance_size;
 
   HeapObject extra_properties_obj = Properties(err);
   if (err.Fail()) return std::string();
 
   FixedArray extra_properties(extra_properties_obj);
+  FieldSnapshot fields(*this, instance_size);
 
   InspectOptions options;
 
   std::string res;
-  for (int64_t i = 0; i < own_descriptors_count; i++) {
-    Smi details = descriptors.GetDetails(i, err);
-    if (err.Fail()) return std::string();
-
-    Value key = descriptors.GetKey(i, err);
-    if (err.Fail()) return std::string();
+  for (size_t i = 0; i < descriptors->descriptors.size(); i++) {
+    const MapDescriptors::Descriptor& descriptor = descriptors->descriptors[i];
+    if (!descriptor.valid || !descriptor.has_name) {
+      err = Error::Failure("Failed to load descriptor %zu", i);
+      return std::string();
+    }
 
     if (!res.empty()) res += ",\n";
 
-    res += "    ." + key.ToString(err) + "=";
-    if (err.Fail()) return std::string();
-
-    if (descriptors.IsConstFieldDetails(details) ||
-        descriptors.IsDescriptorDetails(details)) {
-      Value value;
+    res += "    ." + descriptor.name + "=";
 
-      value = descriptors.GetValue(i, err);
-      if (err.Fail()) return std::string();
+    if (descriptor.kind == MapDescriptors::kConstant) {
+      if (!descriptor.has_value) {
+        err = Error::Failure("Failed to load descriptor %zu", i);
+        return std::string();
+      }
 
+      Value value(v8(), descriptor.value);
       res += value.Inspect(&options, err);
       if (err.Fail()) return std::string();
       continue;
     }
 
-    int64_t index = descriptors.FieldIndex(details) - in_object_count;
+    int64_t index = descriptor.index;
 
-    if (descriptors.IsDoubleField(details)) {
+    if (descriptor.is_double) {
       double value;
       if (index < 0)
-        value = GetInObjectValue<double>(instance_size, index, err);
+        value = GetInObjectValue<double>(fields, instance_size, index, err);
       else
         value = extra_properties.Get<double>(index, err);
 
@@ -3269,7 +3748,7 @@ std::string JSObject::InspectDescriptors(Map map, Error& err) {
     } else {
       Value value;
       if (index < 0)
-        value = GetInObjectValue<Value>(instance_size, index, err);
+        value = GetInObjectValue<Value>(fields, instance_size, index, err);
       else
         value = extra_properties.Get<Value>(index, err);
 
@@ -3285,19 +3764,15 @@ std::string JSObject::InspectDescriptors(Map map, Error& err) {
 
 properties_t* JSObject::InspectDescriptorsX(Map map, Error& err,
                                             int64_t current, int64_t limit) {
-  HeapObject descriptors_obj = map.InstanceDescriptors(err);
+  std::shared_ptr<const MapDescriptors> descriptors = map.Descriptors(err);
   if (err.Fail()) return nullptr;
 
-  DescriptorArray descriptors(descriptors_obj);
-  int64_t own_descriptors_count = map.NumberOfOwnDescriptors(err);
-  if (own_descriptors_count < 0) own_descriptors_count = 0;
-  if (err.Fail()) return nullptr;
-
-  int64_t in_object_count = map.InObjectProperties(err);
-  if (err.Fail()) return nullptr;
-
-  int64_t instance_size = map.InstanceSize(err);
-  if (err.Fail()) return nullptr;
+  if (descriptors->fields_error.Fail()) {
+    err = descriptors->fields_error;
+    return nullptr;
+  }
+  int64_t own_descriptors_count = descriptors->descriptors.size();
+  int64_t instance_size = descriptors->instance_size;
 
   HeapObject extra_properties_obj = Properties(err);
   if (err.Fail()) return nullptr;
@@ -3312,42 +3787,33 @@ properties_t* JSObject::InspectDescriptorsX(Map map, Error& err,
   if (limit != 0) end = current + limit;
   if (end >= own_descriptors_count) end = own_descriptors_count;
 
+  FieldSnapshot fields(*this, instance_size);
+
   properties_t* properties = new properties_t;
   property_t** property = new property_t*[end - start];
   properties->length = static_cast<int>(end - start);
   properties->properties = property;
   properties->current = end;
   for (int64_t i = start; i < end; i++) {
-    Smi details = descriptors.GetDetails(i, err);
-    if (err.Fail()) {
-      delete properties;
-      return nullptr;
-    }
-
-    Value key = descriptors.GetKey(i, err);
-    if (err.Fail()) {
+    const MapDescriptors::Descriptor& descriptor = descriptors->descriptors[i];
+    if (!descriptor.valid || !descriptor.has_name) {
+      err = Error::Failure("Failed to load descriptor %" PRId64, i);
       delete properties;
       return nullptr;
     }
 
     property_t* p = new property_t;
     property[i - start] = p;
-    p->key = key.ToString(err);
-    if (err.Fail()) {
-      delete properties;
-      return nullptr;
-    }
+    p->key = descriptor.name;
 
-    if (descriptors.IsConstFieldDetails(details) ||
-        descriptors.IsDescriptorDetails(details)) {
-      Value value;
-
-      value = descriptors.GetValue(i, err);
-      if (err.Fail()) {
+    if (descriptor.kind == MapDescriptors::kConstant) {
+      if (!descriptor.has_value) {
+        err = Error::Failure("Failed to load descriptor %" PRId64, i);
         delete properties;
         return nullptr;
       }
 
+      Value value(v8(), descriptor.value);
       p->value = value.InspectX(&options, err);
       if (err.Fail()) {
         delete properties;
@@ -3357,20 +3823,20 @@ properties_t* JSObject::InspectDescriptorsX(Map map, Error& err,
     }
 
     // Skip non-fields for now
-    if (!descriptors.IsFieldDetails(details)) {
+    if (descriptor.kind != MapDescriptors::kField) {
       Error::PrintInDebugMode("Unknown field Type %" PRId64,
-                              details.GetValue());
+                              descriptor.details);
       p->value = nullptr;
       p->value_str = "unknown field type";
       continue;
     }
 
-    int64_t index = descriptors.FieldIndex(details) - in_object_count;
+    int64_t index = descriptor.index;
 
-    if (descriptors.IsDoubleField(details)) {
+    if (descriptor.is_double) {
       double value;
       if (index < 0)
-        value = GetInObjectValue<double>(instance_size, index, err);
+        value = GetInObjectValue<double>(fields, instance_size, index, err);
       else
         value = extra_properties.Get<double>(index, err);
 
@@ -3386,7 +3852,7 @@ properties_t* JSObject::InspectDescriptorsX(Map map, Error& err,
     } else {
       Value value;
       if (index < 0)
-        value = GetInObjectValue<Value>(instance_size, index, err);
+        value = GetInObjectValue<Value>(fields, instance_size, index, err);
       else
         value = extra_properties.Get<Value>(index, err);
 
@@ -3408,8 +3874,21 @@ properties_t* JSObject::InspectDescriptorsX(Map map, Error& err,
 
 
 template <class T>
-T JSObject::GetInObjectValue(int64_t size, int index, Error& err) {
-  return LoadFieldValue<T>(size + index * v8()->common()->kPointerSize, err);
+T JSObject::GetInObjectValue(FieldSnapshot& fields, int64_t size, int index,
+                             Error& err) {
+  return fields.Get<T>(size + index * v8()->layout().pointer_size, err);
+}
+
+
+FieldSnapshot::FieldSnapshot(HeapObject obj, int64_t start, int64_t end)
+    : obj_(obj), start_(start) {
+  int64_t size = end - start;
+  if (size > kMaxSize) size = kMaxSize;
+  if (start < 0 || size <= 0 || !obj.Check()) return;
+
+  data_.resize(size);
+  if (!obj.v8()->ReadMemory(obj.LeaField(start), data_.data(), data_.size()))
+    data_.clear();
 }
 
 
@@ -3486,40 +3965,32 @@ std::vector<std::pair<Value, Value>> JSObject::DictionaryEntries(Error& err) {
 
 std::vector<std::pair<Value, Value>> JSObject::DescriptorEntries(Map map,
                                                                  Error& err) {
-  HeapObject descriptors_obj = map.InstanceDescriptors(err);
-  if (err.Fail()) return {};
-
-  DescriptorArray descriptors(descriptors_obj);
-
-  int64_t own_descriptors_count = map.NumberOfOwnDescriptors(err);
+  std::shared_ptr<const MapDescriptors> descriptors = map.Descriptors(err);
   if (err.Fail()) return {};
 
-  int64_t in_object_count = map.InObjectProperties(err);
-  if (err.Fail()) return {};
-
-  int64_t instance_size = map.InstanceSize(err);
-  if (err.Fail()) return {};
+  if (descriptors->fields_error.Fail()) {
+    err = descriptors->fields_error;
+    return {};
+  }
+  int64_t instance_size = descriptors->instance_size;
 
   HeapObject extra_properties_obj = Properties(err);
   if (err.Fail()) return {};
 
   FixedArray extra_properties(extra_properties_obj);
+  FieldSnapshot fields(*this, instance_size);
 
   std::vector<std::pair<Value, Value>> entries;
-  for (int64_t i = 0; i < own_descriptors_count; i++) {
-    Smi details = descriptors.GetDetails(i, err);
-    if (err.Fail()) continue;
+  for (const MapDescriptors::Descriptor& descriptor :
+       descriptors->descriptors) {
+    if (!descriptor.valid) continue;
 
-    Value key = descriptors.GetKey(i, err);
-    if (err.Fail()) continue;
+    Value key(v8(), descriptor.key);
 
-    if (descriptors.IsConstFieldDetails(details) ||
-        descriptors.IsDescriptorDetails(details)) {
-      Value value;
-
-      value = descriptors.GetValue(i, err);
-      if (err.Fail()) continue;
+    if (descriptor.kind == MapDescriptors::kConstant) {
+      if (!descriptor.has_value) continue;
 
+      Value value(v8(), descriptor.value);
       entries.push_back(std::pair<Value, Value>(key, value));
       continue;
     }
@@ -3527,15 +3998,15 @@ std::vector<std::pair<Value, Value>> JSObject::DescriptorEntries(Map map,
     // Skip non-fields for now, Object.keys(obj) does
     // not seem to return these (for example the "length"
     // field on an array).
-    if (!descriptors.IsFieldDetails(details)) continue;
+    if (descriptor.kind != MapDescriptors::kField) continue;
 
-    if (descriptors.IsDoubleField(details)) continue;
+    if (descriptor.is_double) continue;
 
-    int64_t index = descriptors.FieldIndex(details) - in_object_count;
+    int64_t index = descriptor.index;
 
     Value value;
     if (index < 0) {
-      value = GetInObjectValue<Value>(instance_size, index, err);
+      value = GetInObjectValue<Value>(fields, instance_size, index, err);
     } else {
       value = extra_properties.Get<Value>(index, err);
     }
@@ -3557,9 +4028,10 @@ void JSObject::ElementKeys(std::vector<std::string>& keys, Error& err) {
   if (err.Fail()) return;
 
   int64_t length = length_smi.GetValue();
+  FieldSnapshot slots = elements.Snapshot(length);
   for (int i = 0; i < length; ++i) {
     // Add keys for anything that isn't a hole.
-    Value value = elements.Get<Value>(i, err);
+    Value value = elements.Get<Value>(slots, i, err);
     if (err.Fail()) continue;
     ;
 
@@ -3601,34 +4073,30 @@ void JSObject::DictionaryKeys(std::vector<std::string>& keys, Error& err) {
 
 void JSObject::DescriptorKeys(std::vector<std::string>& keys, Map map,
                               Error& err) {
-  HeapObject descriptors_obj = map.InstanceDescriptors(err);
+  std::shared_ptr<const MapDescriptors> descriptors = map.Descriptors(err);
   if (err.Fail()) return;
 
-  DescriptorArray descriptors(descriptors_obj);
-  int64_t own_descriptors_count = map.NumberOfOwnDescriptors(err);
-  if (err.Fail()) return;
-
-  for (int64_t i = 0; i < own_descriptors_count; i++) {
-    Smi details = descriptors.GetDetails(i, err);
-    if (err.Fail()) return;
-
-    Value key = descriptors.GetKey(i, err);
-    if (err.Fail()) return;
+  for (size_t i = 0; i < descriptors->descriptors.size(); i++) {
+    const MapDescriptors::Descriptor& descriptor = descriptors->descriptors[i];
+    if (!descriptor.valid) {
+      err = Error::Failure("Failed to load descriptor %zu", i);
+      return;
+    }
 
     // Skip non-fields for now, Object.keys(obj) does
     // not seem to return these (for example the "length"
     // field on an array).
-    if (!descriptors.IsFieldDetails(details)) {
+    if (descriptor.kind != MapDescriptors::kField) {
       continue;
     }
 
-    std::string key_name = key.ToString(err);
-    if (err.Fail()) {
+    if (!descriptor.has_name) {
       // TODO - should I continue onto the next key here instead.
+      err = Error::Failure("Failed to load the name of descriptor %zu", i);
       return;
     }
 
-    keys.push_back(key_name);
+    keys.push_back(descriptor.name);
   }
 }
 
@@ -3688,85 +4156,38 @@ Value JSObject::GetDictionaryProperty(std::string key_name, Error& err) {
 
 Value JSObject::GetDescriptorProperty(std::string key_name, Map map,
                                       Error& err) {
-  HeapObject descriptors_obj = map.InstanceDescriptors(err);
+  std::shared_ptr<const MapDescriptors> descriptors = map.Descriptors(err);
   if (err.Fail()) return Value();
 
-  DescriptorArray descriptors(descriptors_obj);
-  int64_t own_descriptors_count = map.NumberOfOwnDescriptors(err);
-  if (err.Fail()) return Value();
+  if (descriptors->fields_error.Fail()) {
+    err = descriptors->fields_error;
+    return Value();
+  }
 
-  int64_t in_object_count = map.InObjectProperties(err);
-  if (err.Fail()) return Value();
+  auto it = descriptors->names.find(key_name);
+  if (it == descriptors->names.end()) return Value();
 
-  int64_t instance_size = map.InstanceSize(err);
-  if (err.Fail()) return Value();
+  // Only fields holding a tagged value are returned, not constants nor
+  // doubles
+  const MapDescriptors::Descriptor& descriptor =
+      descriptors->descriptors[it->second];
+  if (descriptor.kind != MapDescriptors::kField || descriptor.is_double)
+    return Value();
+
+  int64_t index = descriptor.index;
+  if (index < 0) {
+    return LoadFieldValue<Value>(
+        descriptors->instance_size + index * v8()->layout().pointer_size,
+        err);
+  }
 
   HeapObject extra_properties_obj = Properties(err);
   if (err.Fail()) return Value();
 
   FixedArray extra_properties(extra_properties_obj);
-
-  for (int64_t i = 0; i < own_descriptors_count; i++) {
-    Smi details = descriptors.GetDetails(i, err);
-    if (err.Fail()) return Value();
-
-    Value key = descriptors.GetKey(i, err);
-    if (err.Fail()) return Value();
-
-    if (key.ToString(err) != key_name) {
-      continue;
-    }
-
-    // Found the right key, get the value.
-    if (err.Fail()) return Value();
-
-    if (descriptors.IsConstFieldDetails(details) ||
-        descriptors.IsDescriptorDetails(details)) {
-      Value value;
-
-      value = descriptors.GetValue(i, err);
-      if (err.Fail()) return Value();
-
-      continue;
-    }
-
-    // Skip non-fields for now
-    if (!descriptors.IsFieldDetails(details)) {
-      // This path would return the length field for an array,
-      // however Object.keys(arr) doesn't return length as a
-      // field so neither do we.
-      continue;
-    }
-
-    int64_t index = descriptors.FieldIndex(details) - in_object_count;
-
-    if (descriptors.IsDoubleField(details)) {
-      double value;
-      if (index < 0) {
-        value = GetInObjectValue<double>(instance_size, index, err);
-      } else {
-        value = extra_properties.Get<double>(index, err);
-      }
-
-      if (err.Fail()) return Value();
-
-    } else {
-      Value value;
-      if (index < 0) {
-        value = GetInObjectValue<Value>(instance_size, index, err);
-      } else {
-        value = extra_properties.Get<Value>(index, err);
-      }
-
-      if (err.Fail()) {
-        return Value();
-      } else {
-        return value;
-      };
-    }
-    if (err.Fail()) return Value();
-  }
-  return Value();
+  Value value = extra_properties.Get<Value>(index, err);
+  if (err.Fail()) return Value();
+  return value;
 }
 
 
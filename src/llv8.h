@@ -2,13 +2,19 @@
 #define SRC_LLV8_H_
 
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <lldb/API/LLDB.h>
 
+#include "src/core-reader.h"
 #include "src/error.h"
 #include "src/llnode-common.h"
 #include "src/llv8-constants.h"
+#include "src/memory-cache.h"
 
 namespace llnode {
 
@@ -21,6 +27,7 @@ class Environment;
 class FindJSObjectsVisitor;
 class FindReferencesCmd;
 class FindObjectsCmd;
+class LLScan;
 
 namespace v8 {
 
@@ -51,6 +58,7 @@ static const UTF32 halfBase = 0x0010000UL;
 // Forward declarations
 class LLV8;
 class CodeMap;
+class FieldSnapshot;
 
 
 #define V8_VALUE_DEFAULT_METHODS(NAME, PARENT)     \
@@ -144,9 +152,50 @@ class HeapObject : public Value {
   inspect_t* InspectX(InspectOptions* options, Error& err);
   std::string GetTypeName(Error& err);
 
+  // Size of the object in bytes, including its variable sized part
+  int64_t Size(Error& err);
+
   inline bool IsJSErrorType(Error& err);
 };
 
+/* Own descriptors of a Map, decoded once and shared by every object using
+ * the map. A descriptor that couldn't be read is kept with `valid` unset.
+ */
+struct MapDescriptors {
+  enum Kind {
+    // Value stored in the descriptor itself, const field or accessor
+    kConstant,
+    // Value stored in the object
+    kField,
+    kOther
+  };
+
+  struct Descriptor {
+    bool valid = false;
+    Kind kind = kOther;
+    int64_t details = 0;
+    int64_t key = 0;
+    // key.ToString(), if it could be read
+    bool has_name = false;
+    std::string name;
+    // kConstant only
+    bool has_value = false;
+    int64_t value = 0;
+    // Not for kConstant: index among the out-of-object properties,
+    // negative for the in-object ones
+    bool is_double = false;
+    int64_t index = 0;
+  };
+
+  std::vector<Descriptor> descriptors;
+  // First descriptor of each name
+  std::unordered_map<std::string, size_t> names;
+
+  // Only JS object maps have fields, reading any fails with this if not
+  Error fields_error;
+  int64_t instance_size = 0;
+};
+
 class Map : public HeapObject {
  public:
   V8_VALUE_DEFAULT_METHODS(Map, HeapObject)
@@ -167,6 +216,11 @@ class Map : public HeapObject {
   std::string Inspect(InspectOptions* options, Error& err);
   map_t* InspectX(InspectOptions* options, Error& err);
   HeapObject Constructor(Error& err);
+
+  /* Decoded own descriptors, cached by map address until the process runs
+   * again.
+   */
+  std::shared_ptr<const MapDescriptors> Descriptors(Error& err);
 };
 
 class Symbol : public HeapObject {
@@ -187,13 +241,29 @@ class String : public HeapObject {
   inline Smi Length(Error& err);
 
   std::string ToString(Error& err, bool utf16 = true);
+
+  /* The first `max_length` characters of the string, or all of them if
+   * `max_length` is negative. Cons, sliced and thin strings are walked with
+   * an explicit stack and every sequential or external string they point to
+   * is copied straight into a buffer allocated once.
+   */
+  std::string Flatten(int64_t max_length, bool utf16, Error& err);
+
   std::string Inspect(InspectOptions* options, Error& err);
-  unsigned long GetSubStr(unsigned long current, int limit, std::string val);
   first_non_string_t* InspectX(InspectOptions* options, Error& err);
 
   static inline bool IsString(LLV8* v8, HeapObject heap_object, Error& err);
 };
 
+/* Source of a Script, one byte per character, and the offset of the start
+ * of every line. The last line starts after the last line break, it is
+ * empty if the source ends with one.
+ */
+struct ScriptSource {
+  std::string source;
+  std::vector<uint32_t> line_starts;
+};
+
 class Script : public HeapObject {
  public:
   V8_VALUE_DEFAULT_METHODS(Script, HeapObject)
@@ -207,6 +277,9 @@ class Script : public HeapObject {
                 uint32_t& lines_found, Error& err);
   void GetLineColumnFromPos(int64_t pos, int64_t& line, int64_t& column,
                             Error& err);
+
+ private:
+  const ScriptSource* LoadSource(Error& err);
 };
 
 class Code : public HeapObject {
@@ -282,6 +355,16 @@ class ThinString : public String {
   inline std::string ToString(Error& err, bool utf16 = true);
 };
 
+class ExternalString : public String {
+ public:
+  V8_VALUE_DEFAULT_METHODS(ExternalString, String)
+
+  /* Address of the characters, owned by the embedder's resource, or -1 if
+   * this V8 doesn't describe external strings or the string is uncached.
+   */
+  inline int64_t ResourceData(Error& err);
+};
+
 class HeapNumber : public HeapObject {
  public:
   V8_VALUE_DEFAULT_METHODS(HeapNumber, HeapObject)
@@ -341,7 +424,8 @@ class JSObject : public HeapObject {
 
  protected:
   template <class T>
-  T GetInObjectValue(int64_t size, int index, Error& err);
+  T GetInObjectValue(FieldSnapshot& fields, int64_t size, int index,
+                     Error& err);
   void ElementKeys(std::vector<std::string>& keys, Error& err);
   void DictionaryKeys(std::vector<std::string>& keys, Error& err);
   void DescriptorKeys(std::vector<std::string>& keys, Map map, Error& err);
@@ -418,6 +502,13 @@ class FixedArray : public FixedArrayBase {
 
   template <class T>
   inline T Get(int index, Error& err);
+  template <class T>
+  inline T Get(FieldSnapshot& slots, int index, Error& err);
+
+  // Snapshot of the first `length` slots, to be read with Get()
+  inline FieldSnapshot Snapshot(int64_t length);
+  // Snapshot of the slots in [start, end)
+  inline FieldSnapshot Snapshot(int64_t start, int64_t end);
 
   inline int64_t LeaData() const;
 
@@ -446,11 +537,49 @@ class DescriptorArray : public FixedArray {
   // NOTE: Only for DATA_CONSTANT
   inline Value GetValue(int index, Error& err);
 
+  // Snapshot of the first `count` descriptors, and the same accessors
+  // decoding from it
+  inline FieldSnapshot Snapshot(int64_t count);
+  inline Smi GetDetails(FieldSnapshot& descriptors, int index, Error& err);
+  inline Value GetKey(FieldSnapshot& descriptors, int index, Error& err);
+  inline Value GetValue(FieldSnapshot& descriptors, int index, Error& err);
+
   inline bool IsFieldDetails(Smi details);
   inline bool IsDescriptorDetails(Smi details);
   inline bool IsConstFieldDetails(Smi details);
   inline bool IsDoubleField(Smi details);
   inline int64_t FieldIndex(Smi details);
+
+ private:
+  inline int64_t SlotIndex(int64_t index, int64_t offset);
+};
+
+/* Copy of the first `size` bytes of a heap object, or of the bytes in
+ * [start, end), read with a single ReadMemory() call so that the fields of an
+ * object, or the slots of an array, don't each need a read of their own.
+ * Offsets are the same as for HeapObject::LoadFieldValue(). Fields outside
+ * the copy, or all of them if the object couldn't be read at once, are loaded
+ * from memory as usual.
+ */
+class FieldSnapshot {
+ public:
+  FieldSnapshot(HeapObject obj, int64_t size) : FieldSnapshot(obj, 0, size) {}
+  FieldSnapshot(HeapObject obj, int64_t start, int64_t end);
+
+  template <class T>
+  inline T Get(int64_t off, Error& err);
+
+ private:
+  // Larger objects are only copied in part, so copies are still served by
+  // the page cache
+  static const int64_t kMaxSize = MemoryCache::kMaxCachedRead;
+
+  inline bool Contains(int64_t off, int64_t size) const;
+
+  HeapObject obj_;
+  // Offset of the first byte of the copy
+  int64_t start_ = 0;
+  std::vector<uint8_t> data_;
 };
 
 class NameDictionary : public FixedArray {
@@ -589,16 +718,68 @@ class JSFrame : public Value {
   Smi FromFrameMarker(Value value) const;
 };
 
+/* Header of a V8 heap page (MemoryChunk), `raw` is the page address. */
+class MemoryChunk : public Value {
+ public:
+  V8_VALUE_DEFAULT_METHODS(MemoryChunk, Value)
+
+  enum Space {
+    kNewSpace,
+    kOldSpace,
+    kCodeSpace,
+    kMapSpace,
+    kLargeObjectSpace,
+    kUnknownSpace
+  };
+
+  static const char* SpaceName(Space space);
+  static inline int64_t Alignment(LLV8* v8);
+
+  inline int64_t Size(Error& err);
+  inline int64_t Flags(Error& err);
+  inline int64_t AreaStart(Error& err);
+  inline int64_t AreaEnd(Error& err);
+
+  /* Whether a page header that fits below `limit` is stored at raw(). */
+  bool Check(int64_t limit, Error& err);
+  Space GetSpace(Error& err);
+};
+
 class LLV8 {
  public:
   LLV8() : target_(lldb::SBTarget()) {}
 
   void Load(lldb::SBTarget target);
 
+  /* Path of the core file backing the target, read directly instead of
+   * through LLDB. Defaults to the LLNODE_COREFILE environment variable.
+   */
+  inline void SetCoreFile(const std::string& path) { core_path_ = path; }
+  inline const CoreMemoryReader& core() const { return core_; }
+
+  /* Load every constant module now instead of on first use. Afterwards the
+   * accessors don't modify LLV8 anymore and can be used from several
+   * threads, as long as memory is read from the mapped core.
+   */
+  void PreloadConstants();
+
  private:
+  void OpenCore();
+
+  // Hot constants, resolved on first use after every target change
+  inline const constants::Layout& layout() {
+    if (!layout_.resolved)
+      layout_.Resolve(&common, &smi, &heap_obj, &map, &fixed_array,
+                      &descriptor_array);
+    return layout_;
+  }
+
   template <class T>
   inline T LoadValue(int64_t addr, Error& err);
 
+  bool ReadMemory(int64_t addr, void* buf, size_t size);
+  int64_t DecodeUnsigned(const uint8_t* buf, uint32_t byte_size);
+
   int64_t LoadConstant(const char* name);
   int64_t LoadPtr(int64_t addr, Error& err);
   int64_t LoadUnsigned(int64_t addr, uint32_t byte_size, Error& err);
@@ -614,6 +795,22 @@ class LLV8 {
 
   lldb::SBTarget target_;
   lldb::SBProcess process_;
+  uint32_t address_byte_size_ = 8;
+  lldb::ByteOrder byte_order_ = lldb::eByteOrderLittle;
+  MemoryCache cache_;
+  // Guards cache_ and process_ reads, the mapped core needs no locking
+  std::mutex memory_mutex_;
+  std::string core_path_;
+  CoreMemoryReader core_;
+
+  // Sources of the last scripts listed, by address. Dropped with the
+  // memory cache.
+  static const size_t kMaxScriptSources = 32;
+  std::unordered_map<int64_t, ScriptSource> script_sources_;
+  // Decoded descriptors of the maps used so far, by address
+  static const size_t kMaxMapDescriptors = 16384;
+  std::unordered_map<int64_t, std::shared_ptr<const MapDescriptors>>
+      map_descriptors_;
 
   constants::Common common;
   constants::Smi smi;
@@ -634,9 +831,14 @@ class LLV8 {
   constants::ConsString cons_string;
   constants::SlicedString sliced_string;
   constants::ThinString thin_string;
+  constants::ExternalString external_string;
   constants::FixedArrayBase fixed_array_base;
   constants::FixedTypedArrayBase fixed_typed_array_base;
   constants::FixedArray fixed_array;
+  constants::PropertyArray property_array;
+  constants::WeakArrayList weak_array_list;
+  constants::BytecodeArray bytecode_array;
+  constants::FeedbackVector feedback_vector;
   constants::Oddball oddball;
   constants::JSArrayBuffer js_array_buffer;
   constants::JSArrayBufferView js_array_buffer_view;
@@ -646,7 +848,9 @@ class LLV8 {
   constants::NameDictionary name_dictionary;
   constants::Frame frame;
   constants::Symbol symbol;
+  constants::MemoryChunk memory_chunk;
   constants::Types types;
+  constants::Layout layout_;
 
   friend class Value;
   friend class JSFrame;
@@ -663,6 +867,7 @@ class LLV8 {
   friend class ConsString;
   friend class SlicedString;
   friend class ThinString;
+  friend class ExternalString;
   friend class HeapNumber;
   friend class JSObject;
   friend class JSError;
@@ -671,6 +876,7 @@ class LLV8 {
   friend class FixedArray;
   friend class FixedTypedArrayBase;
   friend class DescriptorArray;
+  friend class FieldSnapshot;
   friend class NameDictionary;
   friend class Context;
   friend class ScopeInfo;
@@ -681,9 +887,11 @@ class LLV8 {
   friend class JSDate;
   friend class CodeMap;
   friend class Symbol;
+  friend class MemoryChunk;
   friend class llnode::FindJSObjectsVisitor;
   friend class llnode::FindObjectsCmd;
   friend class llnode::FindReferencesCmd;
+  friend class llnode::LLScan;
   friend class llnode::node::constants::Environment;
 };
 
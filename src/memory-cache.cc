@@ -0,0 +1,111 @@
+#include <string.h>
+
+#include <algorithm>
+
+#include "src/memory-cache.h"
+
+namespace llnode {
+
+using lldb::addr_t;
+using lldb::SBError;
+using lldb::SBProcess;
+
+bool MemoryCache::SetProcess(SBProcess process) {
+  uint32_t stop_id = process.GetStopID();
+  if (process_.IsValid() && process.IsValid() &&
+      process_.GetUniqueID() == process.GetUniqueID() && stop_id_ == stop_id) {
+    return false;
+  }
+
+  Clear();
+  process_ = process;
+  stop_id_ = stop_id;
+  return true;
+}
+
+
+void MemoryCache::SetBudget(uint64_t budget) {
+  budget_ = budget;
+  slots_.clear();
+  storage_.clear();
+  index_.clear();
+  hand_ = 0;
+}
+
+
+void MemoryCache::Clear() {
+  for (Slot& slot : slots_) {
+    slot.used = false;
+    slot.referenced = false;
+  }
+  index_.clear();
+  hand_ = 0;
+}
+
+
+MemoryCache::Slot* MemoryCache::Lookup(uint64_t page) {
+  auto it = index_.find(page);
+  if (it == index_.end()) return nullptr;
+
+  Slot* slot = &slots_[it->second];
+  slot->referenced = true;
+  return slot;
+}
+
+
+MemoryCache::Slot* MemoryCache::Fill(uint64_t page) {
+  // Slots are allocated lazily, so small sessions don't pay for the budget.
+  if (slots_.empty()) {
+    size_t count = static_cast<size_t>(budget_ / kPageSize);
+    slots_.resize(count, Slot{0, 0, false, false});
+    storage_.resize(count * kPageSize);
+  }
+
+  // CLOCK: skip recently referenced slots, clearing their bit as we pass.
+  Slot* slot;
+  while (true) {
+    slot = &slots_[hand_];
+    hand_ = (hand_ + 1) % slots_.size();
+    if (!slot->used || !slot->referenced) break;
+    slot->referenced = false;
+  }
+
+  if (slot->used) index_.erase(slot->page);
+
+  SBError sberr;
+  size_t loaded = process_.ReadMemory(static_cast<addr_t>(page << kPageBits),
+                                      SlotData(slot), kPageSize, sberr);
+  // A failed read is cached too, so unreadable pages cost one round trip.
+  if (sberr.Fail()) loaded = 0;
+
+  slot->page = page;
+  slot->valid_bytes = static_cast<uint32_t>(loaded);
+  slot->used = true;
+  slot->referenced = true;
+  index_[page] = slot - &slots_[0];
+  return slot;
+}
+
+
+bool MemoryCache::Read(uint64_t addr, void* buf, size_t size) {
+  uint8_t* out = static_cast<uint8_t*>(buf);
+
+  while (size > 0) {
+    uint64_t page = addr >> kPageBits;
+    uint64_t offset = addr & (kPageSize - 1);
+    size_t chunk = std::min<uint64_t>(size, kPageSize - offset);
+
+    Slot* slot = Lookup(page);
+    if (slot == nullptr) slot = Fill(page);
+    if (offset + chunk > slot->valid_bytes) return false;
+
+    memcpy(out, SlotData(slot) + offset, chunk);
+    out += chunk;
+    addr += chunk;
+    size -= chunk;
+  }
+
+  return true;
+}
+
+}  // namespace llnode
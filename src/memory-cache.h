@@ -0,0 +1,76 @@
+#ifndef SRC_MEMORY_CACHE_H_
+#define SRC_MEMORY_CACHE_H_
+
+#include <lldb/API/LLDB.h>
+#include <unordered_map>
+#include <vector>
+
+namespace llnode {
+
+/* Page-granular read cache in front of SBProcess::ReadMemory.
+ *
+ * Memory is fetched from the debugged process one fixed-size page at a time
+ * and kept in a bounded pool of page slots, evicted with the CLOCK (second
+ * chance) algorithm. Typed loads in LLV8 are then served from these local
+ * buffers instead of costing one LLDB round trip each.
+ *
+ * The cache is dropped whenever the process changes or resumes (its stop id
+ * moves forward), so it is safe to use on live processes as well as cores.
+ */
+class MemoryCache {
+ public:
+  static const uint64_t kPageBits = 12;
+  static const uint64_t kPageSize = 1ULL << kPageBits;
+  static const uint64_t kDefaultBudget = 64 * 1024 * 1024;
+  // Reads larger than this bypass the cache to avoid flushing it.
+  static const uint64_t kMaxCachedRead = 4 * kPageSize;
+
+  MemoryCache() : budget_(kDefaultBudget), hand_(0), stop_id_(0) {}
+
+  /* Start serving reads for `process`. Previously cached pages are kept only
+   * if this is the same process and it hasn't run in the meantime. Returns
+   * true if they were dropped.
+   */
+  bool SetProcess(lldb::SBProcess process);
+
+  /* Set the maximum amount of memory used for cached pages, in bytes. A
+   * budget of zero disables the cache.
+   */
+  void SetBudget(uint64_t budget);
+  inline uint64_t budget() const { return budget_; }
+  inline bool enabled() const { return budget_ >= kPageSize; }
+
+  void Clear();
+
+  /* Copy `size` bytes at `addr` into `buf`. Returns false if any part of the
+   * range could not be read from the process.
+   */
+  bool Read(uint64_t addr, void* buf, size_t size);
+
+ private:
+  struct Slot {
+    uint64_t page;
+    uint32_t valid_bytes;
+    bool used;
+    bool referenced;
+  };
+
+  Slot* Lookup(uint64_t page);
+  Slot* Fill(uint64_t page);
+  inline uint8_t* SlotData(Slot* slot) {
+    return &storage_[(slot - &slots_[0]) * kPageSize];
+  }
+
+  lldb::SBProcess process_;
+  uint64_t budget_;
+  size_t hand_;
+  uint32_t stop_id_;
+
+  std::vector<Slot> slots_;
+  std::vector<uint8_t> storage_;
+  std::unordered_map<uint64_t, size_t> index_;
+};
+
+}  // namespace llnode
+
+#endif  // SRC_MEMORY_CACHE_H_
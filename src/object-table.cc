@@ -0,0 +1,295 @@
+#include <algorithm>
+
+#include "src/llscan.h"
+#include "src/object-table.h"
+
+namespace llnode {
+
+uint32_t ObjectTable::AddMap(uint64_t map, TypeRecord* record,
+                             DetailedTypeRecord* detailed_record,
+                             uint64_t size) {
+  maps_.push_back(MapInfo{map, record, detailed_record, size});
+  return static_cast<uint32_t>(maps_.size() - 1);
+}
+
+
+void ObjectTable::AddObject(uint64_t address, uint32_t map_id) {
+  staged_.push_back(StagedObject{address, map_id});
+  if (staged_.size() >= staged_limit_) Compact();
+}
+
+
+/* Sort the staged objects and drop duplicates, a pointer scan finds most
+ * objects many times.
+ */
+void ObjectTable::Compact() {
+  std::sort(staged_.begin(), staged_.end(),
+            [](const StagedObject& a, const StagedObject& b) {
+              return a.address < b.address;
+            });
+  auto end = std::unique(staged_.begin(), staged_.end(),
+                         [](const StagedObject& a, const StagedObject& b) {
+                           return a.address == b.address;
+                         });
+  staged_.erase(end, staged_.end());
+
+  // Only compact again once the unique objects have been doubled
+  staged_limit_ = std::max(kMinStagedLimit, staged_.size() * 2);
+}
+
+
+void ObjectTable::Merge(
+    ObjectTable& other,
+    const std::unordered_map<TypeRecord*, TypeRecord*>& records) {
+  uint32_t first_map = static_cast<uint32_t>(maps_.size());
+  for (MapInfo info : other.maps_) {
+    auto it = records.find(info.record);
+    if (it != records.end()) info.record = it->second;
+    it = records.find(info.detailed_record);
+    if (it != records.end())
+      info.detailed_record = static_cast<DetailedTypeRecord*>(it->second);
+    maps_.push_back(info);
+  }
+
+  for (const StagedObject& object : other.staged_)
+    AddObject(object.address, object.map_id + first_map);
+
+  other.Clear();
+}
+
+
+void ObjectTable::BuildPostingList(const std::vector<uint32_t>& ids,
+                                   uint32_t count,
+                                   std::vector<uint32_t>& offsets,
+                                   std::vector<uint32_t>& rows) {
+  // Counting sort of the rows by id, rows stay in address order
+  offsets.assign(count + 1, 0);
+  for (uint32_t id : ids) offsets[id + 1]++;
+  for (uint32_t i = 0; i < count; i++) offsets[i + 1] += offsets[i];
+
+  rows.resize(ids.size());
+  std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+  for (uint32_t row = 0; row < ids.size(); row++) rows[next[ids[row]]++] = row;
+}
+
+
+void ObjectTable::Finalize(
+    const std::vector<TypeRecord*>& records,
+    const std::vector<DetailedTypeRecord*>& detailed_records) {
+  Compact();
+
+  blocks_.clear();
+  offsets_.resize(staged_.size());
+  map_ids_.resize(staged_.size());
+  for (uint32_t row = 0; row < staged_.size(); row++) {
+    uint64_t address = staged_[row].address;
+    uint64_t base = address & ~static_cast<uint64_t>(0xffffffff);
+    if (blocks_.empty() || blocks_.back().base != base)
+      blocks_.push_back(Block{row, base});
+
+    offsets_[row] = static_cast<uint32_t>(address - base);
+    map_ids_[row] = staged_[row].map_id;
+  }
+  staged_.clear();
+  staged_.shrink_to_fit();
+  staged_limit_ = kMinStagedLimit;
+
+  // Type ids are the positions in `records`, resolved once per map
+  std::unordered_map<TypeRecord*, uint32_t> type_ids;
+  for (uint32_t i = 0; i < records.size(); i++) type_ids[records[i]] = i;
+  for (uint32_t i = 0; i < detailed_records.size(); i++)
+    type_ids[detailed_records[i]] = i;
+
+  map_types_.resize(maps_.size());
+  map_detailed_types_.resize(maps_.size());
+  for (uint32_t i = 0; i < maps_.size(); i++) {
+    map_types_[i] = type_ids[maps_[i].record];
+    map_detailed_types_[i] = type_ids[maps_[i].detailed_record];
+  }
+
+  std::vector<uint32_t> ids(map_ids_.size());
+  for (uint32_t row = 0; row < map_ids_.size(); row++)
+    ids[row] = map_types_[map_ids_[row]];
+  BuildPostingList(ids, records.size(), type_offsets_, type_rows_);
+
+  for (uint32_t row = 0; row < map_ids_.size(); row++)
+    ids[row] = map_detailed_types_[map_ids_[row]];
+  BuildPostingList(ids, detailed_records.size(), detailed_offsets_,
+                   detailed_rows_);
+
+  BindRecords(records, detailed_records);
+}
+
+
+/* Point every record at its posting list and recompute its totals. */
+void ObjectTable::BindRecords(
+    const std::vector<TypeRecord*>& records,
+    const std::vector<DetailedTypeRecord*>& detailed_records) {
+  finalized_ = true;
+
+  for (uint32_t i = 0; i < records.size(); i++) {
+    TypeRecord* record = records[i];
+    record->instances_ = GetInstances(i, false);
+    record->instance_count_ = record->instances_.size();
+    record->total_instance_size_ = 0;
+    for (uint32_t row = type_offsets_[i]; row < type_offsets_[i + 1]; row++)
+      record->total_instance_size_ += GetSize(type_rows_[row]);
+  }
+
+  for (uint32_t i = 0; i < detailed_records.size(); i++) {
+    TypeRecord* record = detailed_records[i];
+    record->instances_ = GetInstances(i, true);
+    record->instance_count_ = record->instances_.size();
+    record->total_instance_size_ = 0;
+    for (uint32_t row = detailed_offsets_[i]; row < detailed_offsets_[i + 1];
+         row++)
+      record->total_instance_size_ += GetSize(detailed_rows_[row]);
+  }
+}
+
+
+void ObjectTable::Save(ScanIndexWriter& writer) const {
+  std::vector<uint64_t> maps;
+  std::vector<uint64_t> sizes;
+  for (const MapInfo& info : maps_) {
+    maps.push_back(info.map);
+    sizes.push_back(info.size);
+  }
+  writer.WriteArray(maps);
+  writer.WriteArray(sizes);
+  writer.WriteArray(map_types_);
+  writer.WriteArray(map_detailed_types_);
+
+  std::vector<uint64_t> block_rows;
+  std::vector<uint64_t> block_bases;
+  for (const Block& block : blocks_) {
+    block_rows.push_back(block.first_row);
+    block_bases.push_back(block.base);
+  }
+  writer.WriteArray(block_rows);
+  writer.WriteArray(block_bases);
+  writer.WriteArray(offsets_);
+  writer.WriteArray(map_ids_);
+
+  writer.WriteArray(type_offsets_);
+  writer.WriteArray(type_rows_);
+  writer.WriteArray(detailed_offsets_);
+  writer.WriteArray(detailed_rows_);
+}
+
+
+bool ObjectTable::Load(
+    ScanIndexReader& reader, const std::vector<TypeRecord*>& records,
+    const std::vector<DetailedTypeRecord*>& detailed_records) {
+  Clear();
+
+  std::vector<uint64_t> maps;
+  std::vector<uint64_t> sizes;
+  reader.ReadArray(maps);
+  reader.ReadArray(sizes);
+  reader.ReadArray(map_types_);
+  reader.ReadArray(map_detailed_types_);
+
+  std::vector<uint64_t> block_rows;
+  std::vector<uint64_t> block_bases;
+  reader.ReadArray(block_rows);
+  reader.ReadArray(block_bases);
+  reader.ReadArray(offsets_);
+  reader.ReadArray(map_ids_);
+
+  reader.ReadArray(type_offsets_);
+  reader.ReadArray(type_rows_);
+  reader.ReadArray(detailed_offsets_);
+  reader.ReadArray(detailed_rows_);
+
+  // Everything is used as an index somewhere, check it all once here
+  bool valid = !reader.failed() && sizes.size() == maps.size() &&
+               map_types_.size() == maps.size() &&
+               map_detailed_types_.size() == maps.size() &&
+               block_bases.size() == block_rows.size() &&
+               map_ids_.size() == offsets_.size() &&
+               type_offsets_.size() == records.size() + 1 &&
+               detailed_offsets_.size() == detailed_records.size() + 1 &&
+               type_rows_.size() == map_ids_.size() &&
+               detailed_rows_.size() == map_ids_.size() &&
+               (map_ids_.empty() ||
+                (!block_rows.empty() && block_rows[0] == 0));
+  for (uint32_t i = 0; valid && i < maps.size(); i++) {
+    valid = map_types_[i] < records.size() &&
+            map_detailed_types_[i] < detailed_records.size();
+  }
+  for (uint32_t id : map_ids_) valid = valid && id < maps.size();
+  for (uint32_t row : type_rows_) valid = valid && row < map_ids_.size();
+  for (uint32_t row : detailed_rows_) valid = valid && row < map_ids_.size();
+  for (uint32_t offset : type_offsets_)
+    valid = valid && offset <= type_rows_.size();
+  for (uint32_t offset : detailed_offsets_)
+    valid = valid && offset <= detailed_rows_.size();
+  if (!valid) {
+    Clear();
+    return false;
+  }
+
+  for (uint32_t i = 0; i < maps.size(); i++) {
+    maps_.push_back(MapInfo{maps[i], records[map_types_[i]],
+                            detailed_records[map_detailed_types_[i]],
+                            sizes[i]});
+  }
+  for (uint32_t i = 0; i < block_rows.size(); i++) {
+    blocks_.push_back(
+        Block{static_cast<uint32_t>(block_rows[i]), block_bases[i]});
+  }
+
+  BindRecords(records, detailed_records);
+  return true;
+}
+
+
+void ObjectTable::Clear() {
+  maps_.clear();
+  map_types_.clear();
+  map_detailed_types_.clear();
+  staged_.clear();
+  staged_limit_ = kMinStagedLimit;
+  finalized_ = false;
+  blocks_.clear();
+  offsets_.clear();
+  map_ids_.clear();
+  type_offsets_.clear();
+  type_rows_.clear();
+  detailed_offsets_.clear();
+  detailed_rows_.clear();
+}
+
+
+int64_t ObjectTable::Find(uint64_t address) const {
+  uint64_t base = address & ~static_cast<uint64_t>(0xffffffff);
+  auto block = std::lower_bound(
+      blocks_.begin(), blocks_.end(), base,
+      [](const Block& b, uint64_t value) { return b.base < value; });
+  if (block == blocks_.end() || block->base != base) return -1;
+
+  uint32_t first = block->first_row;
+  uint32_t last = block + 1 == blocks_.end() ? offsets_.size()
+                                             : (block + 1)->first_row;
+  uint32_t offset = static_cast<uint32_t>(address - base);
+  auto it = std::lower_bound(offsets_.begin() + first, offsets_.begin() + last,
+                             offset);
+  if (it == offsets_.begin() + last || *it != offset) return -1;
+  return it - offsets_.begin();
+}
+
+
+InstanceRange ObjectTable::GetInstances(uint32_t type_id,
+                                        bool detailed) const {
+  const std::vector<uint32_t>& offsets =
+      detailed ? detailed_offsets_ : type_offsets_;
+  const std::vector<uint32_t>& rows = detailed ? detailed_rows_ : type_rows_;
+  if (type_id + 1 >= offsets.size()) return InstanceRange();
+
+  const uint32_t* data = rows.data();
+  return InstanceRange(this, data + offsets[type_id],
+                       data + offsets[type_id + 1]);
+}
+
+}  // namespace llnode
@@ -0,0 +1,188 @@
+#ifndef SRC_OBJECT_TABLE_H_
+#define SRC_OBJECT_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "src/scan-index.h"
+
+namespace llnode {
+
+class TypeRecord;
+class DetailedTypeRecord;
+class ObjectTable;
+
+/* Addresses of the objects at a list of rows of an ObjectTable. */
+class InstanceRange {
+ public:
+  class iterator {
+   public:
+    iterator(const ObjectTable* table, const uint32_t* row)
+        : table_(table), row_(row) {}
+
+    inline uint64_t operator*() const;
+    inline iterator& operator++() {
+      ++row_;
+      return *this;
+    }
+    inline bool operator==(const iterator& other) const {
+      return row_ == other.row_;
+    }
+    inline bool operator!=(const iterator& other) const {
+      return row_ != other.row_;
+    }
+
+   private:
+    const ObjectTable* table_;
+    const uint32_t* row_;
+  };
+
+  InstanceRange() : table_(nullptr), begin_(nullptr), end_(nullptr) {}
+  InstanceRange(const ObjectTable* table, const uint32_t* begin,
+                const uint32_t* end)
+      : table_(table), begin_(begin), end_(end) {}
+
+  inline iterator begin() const { return iterator(table_, begin_); }
+  inline iterator end() const { return iterator(table_, end_); }
+  inline size_t size() const { return end_ - begin_; }
+  inline bool empty() const { return begin_ == end_; }
+
+ private:
+  const ObjectTable* table_;
+  const uint32_t* begin_;
+  const uint32_t* end_;
+};
+
+/* Every object found by a heap scan, stored column-wise.
+ *
+ * During the scan objects are appended as (address, map id) rows and
+ * deduplicated from time to time. Finalize() sorts them by address and
+ * builds the columns: each address is stored as a 32-bit offset from the
+ * base of its 4GB block, next to the id of its map. Type and size are
+ * properties of the map, and the instances of each TypeRecord and
+ * DetailedTypeRecord become a posting list of rows (CSR layout), so a
+ * record is a view over the table instead of a set of its own.
+ */
+class ObjectTable {
+ public:
+  ObjectTable() : staged_limit_(kMinStagedLimit), finalized_(false) {}
+
+  /* Register a map, returns the id to pass to AddObject. */
+  uint32_t AddMap(uint64_t map, TypeRecord* record,
+                  DetailedTypeRecord* detailed_record, uint64_t size);
+  void AddObject(uint64_t address, uint32_t map_id);
+
+  /* Move all objects and maps of `other` into this table. Records of
+   * `other` are replaced by their counterpart in `records`.
+   */
+  void Merge(ObjectTable& other,
+             const std::unordered_map<TypeRecord*, TypeRecord*>& records);
+
+  /* Sort and deduplicate the objects, then fill in the type records. */
+  void Finalize(const std::vector<TypeRecord*>& records,
+                const std::vector<DetailedTypeRecord*>& detailed_records);
+  void Clear();
+
+  /* Store a finalized table in a scan index, or load it back. Records are
+   * identified by their position in the vectors given to Finalize(), which
+   * must be recreated in the same order before calling Load().
+   */
+  void Save(ScanIndexWriter& writer) const;
+  bool Load(ScanIndexReader& reader, const std::vector<TypeRecord*>& records,
+            const std::vector<DetailedTypeRecord*>& detailed_records);
+
+  inline bool finalized() const { return finalized_; }
+  inline size_t size() const { return map_ids_.size(); }
+
+  inline uint64_t GetAddress(uint32_t row) const;
+  inline uint64_t GetMap(uint32_t row) const {
+    return maps_[map_ids_[row]].map;
+  }
+  inline uint64_t GetSize(uint32_t row) const {
+    return maps_[map_ids_[row]].size;
+  }
+  inline TypeRecord* GetTypeRecord(uint32_t row) const {
+    return maps_[map_ids_[row]].record;
+  }
+  inline DetailedTypeRecord* GetDetailedTypeRecord(uint32_t row) const {
+    return maps_[map_ids_[row]].detailed_record;
+  }
+
+  /* Row of the object at `address`, or -1 if it isn't in the table. */
+  int64_t Find(uint64_t address) const;
+
+  InstanceRange GetInstances(uint32_t type_id, bool detailed) const;
+
+ private:
+  static const size_t kMinStagedLimit = 1 << 20;
+
+  struct MapInfo {
+    uint64_t map;
+    TypeRecord* record;
+    DetailedTypeRecord* detailed_record;
+    uint64_t size;
+  };
+
+  struct StagedObject {
+    uint64_t address;
+    uint32_t map_id;
+  };
+
+  struct Block {
+    uint32_t first_row;
+    uint64_t base;
+  };
+
+  void Compact();
+  void BindRecords(const std::vector<TypeRecord*>& records,
+                   const std::vector<DetailedTypeRecord*>& detailed_records);
+  void BuildPostingList(const std::vector<uint32_t>& ids, uint32_t count,
+                        std::vector<uint32_t>& offsets,
+                        std::vector<uint32_t>& rows);
+
+  std::vector<MapInfo> maps_;
+  // Type ids of every map, set by Finalize()
+  std::vector<uint32_t> map_types_;
+  std::vector<uint32_t> map_detailed_types_;
+
+  std::vector<StagedObject> staged_;
+  size_t staged_limit_;
+  bool finalized_;
+
+  // Columns, one entry per object sorted by address
+  std::vector<Block> blocks_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> map_ids_;
+
+  // Rows of every type, type_offsets_[id] to type_offsets_[id + 1]
+  std::vector<uint32_t> type_offsets_;
+  std::vector<uint32_t> type_rows_;
+  std::vector<uint32_t> detailed_offsets_;
+  std::vector<uint32_t> detailed_rows_;
+};
+
+
+inline uint64_t ObjectTable::GetAddress(uint32_t row) const {
+  // Find the last block starting at or before `row`
+  size_t low = 0;
+  size_t high = blocks_.size();
+  while (high - low > 1) {
+    size_t mid = (low + high) / 2;
+    if (blocks_[mid].first_row <= row)
+      low = mid;
+    else
+      high = mid;
+  }
+  return blocks_[low].base + offsets_[row];
+}
+
+
+inline uint64_t InstanceRange::iterator::operator*() const {
+  return table_->GetAddress(*row_);
+}
+
+}  // namespace llnode
+
+#endif  // SRC_OBJECT_TABLE_H_
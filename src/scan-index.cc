@@ -0,0 +1,184 @@
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include "src/scan-index.h"
+
+namespace llnode {
+
+static const char kScanIndexMagic[8] = {'L', 'L', 'N', 'I', 'D', 'X', 0, 0};
+// Bump whenever the layout of the index or of any section changes
+static const uint64_t kScanIndexVersion = 6;
+
+
+bool ScanIndexKey::Load(const std::string& core_path, Error& err) {
+#ifdef _WIN32
+  err = Error::Failure("Scan indexes are not supported on this platform");
+  return false;
+#else
+  struct stat st;
+  if (stat(core_path.c_str(), &st) != 0) {
+    err = Error::Failure("Failed to stat core file '%s'", core_path.c_str());
+    return false;
+  }
+
+  core_size = static_cast<uint64_t>(st.st_size);
+  core_mtime = static_cast<uint64_t>(st.st_mtime);
+  err = Error::Ok();
+  return true;
+#endif  // _WIN32
+}
+
+
+ScanIndexWriter::~ScanIndexWriter() {
+  if (file_ == nullptr) return;
+
+  // Never committed, don't leave a partial index behind
+  fclose(file_);
+  remove(tmp_path_.c_str());
+}
+
+
+bool ScanIndexWriter::Open(const std::string& path, const ScanIndexKey& key,
+                           Error& err) {
+  path_ = path;
+  tmp_path_ = path + ".tmp";
+  file_ = fopen(tmp_path_.c_str(), "wb");
+  if (file_ == nullptr) {
+    err = Error::Failure("Failed to create scan index '%s'", tmp_path_.c_str());
+    return false;
+  }
+
+  Write(kScanIndexMagic, sizeof(kScanIndexMagic));
+  WriteU64(kScanIndexVersion);
+  WriteU64(key.core_size);
+  WriteU64(key.core_mtime);
+  WriteString(key.build_id);
+  WriteU64(key.options);
+
+  err = Error::Ok();
+  return true;
+}
+
+
+bool ScanIndexWriter::Commit(Error& err) {
+  bool failed = failed_;
+  if (fclose(file_) != 0) failed = true;
+  file_ = nullptr;
+
+  if (failed || rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+    remove(tmp_path_.c_str());
+    err = Error::Failure("Failed to write scan index '%s'", path_.c_str());
+    return false;
+  }
+
+  err = Error::Ok();
+  return true;
+}
+
+
+void ScanIndexWriter::WriteString(const std::string& value) {
+  WriteU64(value.size());
+  Write(value.data(), value.size());
+}
+
+
+void ScanIndexWriter::Write(const void* data, size_t size) {
+  if (failed_) return;
+  if (size > 0 && fwrite(data, 1, size, file_) != size) failed_ = true;
+
+  // Keep every field 8-byte aligned
+  static const uint8_t padding[8] = {0};
+  size_t pad = (8 - size % 8) % 8;
+  if (pad > 0 && fwrite(padding, 1, pad, file_) != pad) failed_ = true;
+}
+
+
+ScanIndexReader::~ScanIndexReader() {
+#ifndef _WIN32
+  if (data_ != nullptr)
+    munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+#endif  // _WIN32
+}
+
+
+bool ScanIndexReader::Open(const std::string& path, const ScanIndexKey& key,
+                           Error& err) {
+#ifdef _WIN32
+  err = Error::Failure("Scan indexes are not supported on this platform");
+  return false;
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    err = Error::Failure("No scan index at '%s'", path.c_str());
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    err = Error::Failure("Failed to stat scan index '%s'", path.c_str());
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    err = Error::Failure("Failed to map scan index '%s'", path.c_str());
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = static_cast<uint64_t>(st.st_size);
+
+  const uint8_t* magic = Read(sizeof(kScanIndexMagic));
+  if (magic == nullptr ||
+      memcmp(magic, kScanIndexMagic, sizeof(kScanIndexMagic)) != 0 ||
+      ReadU64() != kScanIndexVersion) {
+    err = Error::Failure("'%s' is not a scan index of this version",
+                         path.c_str());
+    return false;
+  }
+
+  ScanIndexKey index_key;
+  index_key.core_size = ReadU64();
+  index_key.core_mtime = ReadU64();
+  index_key.build_id = ReadString();
+  index_key.options = ReadU64();
+  if (failed_ || index_key != key) {
+    err = Error::Failure("Scan index '%s' was built from another core",
+                         path.c_str());
+    return false;
+  }
+
+  err = Error::Ok();
+  return true;
+#endif  // _WIN32
+}
+
+
+std::string ScanIndexReader::ReadString() {
+  uint64_t size = ReadU64();
+  const uint8_t* data = Read(size);
+  if (data == nullptr) return std::string();
+  return std::string(reinterpret_cast<const char*>(data), size);
+}
+
+
+const uint8_t* ScanIndexReader::Read(size_t size) {
+  uint64_t padded = (static_cast<uint64_t>(size) + 7) & ~7ULL;
+  if (failed_ || padded < size || padded > size_ - offset_) {
+    failed_ = true;
+    return nullptr;
+  }
+
+  const uint8_t* data = data_ + offset_;
+  offset_ += padded;
+  return data;
+}
+
+}  // namespace llnode
@@ -0,0 +1,122 @@
+#ifndef SRC_SCAN_INDEX_H_
+#define SRC_SCAN_INDEX_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "src/error.h"
+
+namespace llnode {
+
+/* Identity of the core a scan index was built from. An index is only used
+ * if all of these match, so a core overwritten in place is scanned again.
+ */
+struct ScanIndexKey {
+  uint64_t core_size = 0;
+  uint64_t core_mtime = 0;
+  // UUID (build-id) of the executable, as reported by LLDB
+  std::string build_id;
+  // Scan options that change what is found, see LLScan::LoadScanIndexKey()
+  uint64_t options = 0;
+
+  bool Load(const std::string& core_path, Error& err);
+
+  inline bool operator==(const ScanIndexKey& other) const {
+    return core_size == other.core_size && core_mtime == other.core_mtime &&
+           build_id == other.build_id && options == other.options;
+  }
+  inline bool operator!=(const ScanIndexKey& other) const {
+    return !(*this == other);
+  }
+};
+
+/* Writes a scan index: a header with the key followed by sections of
+ * 8-byte aligned arrays in host byte order, so a reader can copy every
+ * array straight out of the mapped file. The file is written next to its
+ * final path and renamed into place once complete.
+ */
+class ScanIndexWriter {
+ public:
+  ScanIndexWriter() {}
+  ~ScanIndexWriter();
+
+  bool Open(const std::string& path, const ScanIndexKey& key, Error& err);
+  bool Commit(Error& err);
+
+  void WriteU64(uint64_t value) { Write(&value, sizeof(value)); }
+  void WriteString(const std::string& value);
+
+  template <class T>
+  void WriteArray(const std::vector<T>& values) {
+    WriteU64(values.size());
+    Write(values.data(), values.size() * sizeof(T));
+  }
+
+ private:
+  ScanIndexWriter(const ScanIndexWriter&) = delete;
+  ScanIndexWriter& operator=(const ScanIndexWriter&) = delete;
+
+  void Write(const void* data, size_t size);
+
+  FILE* file_ = nullptr;
+  std::string path_;
+  std::string tmp_path_;
+  bool failed_ = false;
+};
+
+/* Maps a scan index written by ScanIndexWriter. Reads past the end of the
+ * file or of a malformed section fail and leave the reader failed, so
+ * callers can check once after reading everything.
+ */
+class ScanIndexReader {
+ public:
+  ScanIndexReader() {}
+  ~ScanIndexReader();
+
+  /* Returns false if the file doesn't exist, is of another version or was
+   * built from another core.
+   */
+  bool Open(const std::string& path, const ScanIndexKey& key, Error& err);
+
+  inline bool failed() const { return failed_; }
+
+  uint64_t ReadU64() {
+    uint64_t value = 0;
+    const uint8_t* data = Read(sizeof(value));
+    if (data != nullptr) memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  std::string ReadString();
+
+  template <class T>
+  void ReadArray(std::vector<T>& values) {
+    uint64_t count = ReadU64();
+    if (count > (size_ - offset_) / sizeof(T)) {
+      failed_ = true;
+      count = 0;
+    }
+    const T* data = reinterpret_cast<const T*>(Read(count * sizeof(T)));
+    if (data == nullptr)
+      values.clear();
+    else
+      values.assign(data, data + count);
+  }
+
+ private:
+  ScanIndexReader(const ScanIndexReader&) = delete;
+  ScanIndexReader& operator=(const ScanIndexReader&) = delete;
+
+  const uint8_t* Read(size_t size);
+
+  const uint8_t* data_ = nullptr;
+  uint64_t size_ = 0;
+  uint64_t offset_ = 0;
+  bool failed_ = false;
+};
+
+}  // namespace llnode
+
+#endif  // SRC_SCAN_INDEX_H_
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <iterator>
+
+#include "src/string-index.h"
+
+namespace llnode {
+
+void StringIndex::Build(const std::vector<uint64_t>& strings,
+                        const ContentFunction& content, bool grams) {
+  Clear();
+
+  std::vector<uint64_t> addresses(strings);
+  std::sort(addresses.begin(), addresses.end());
+  addresses.erase(std::unique(addresses.begin(), addresses.end()),
+                  addresses.end());
+  if (addresses.size() >= UINT32_MAX) return;
+
+  // Packed (trigram << 32 | id) pairs of the current chunk of strings,
+  // turned into posting lists whenever kChunkPairs are collected so the
+  // pairs never take more than a bounded amount of memory
+  std::vector<uint64_t> pairs;
+  std::vector<GramChunk> chunks;
+  uint64_t postings = 0;
+  std::vector<uint32_t> string_grams;
+  std::vector<std::pair<uint64_t, uint32_t>> hashes;
+  std::string value;
+  for (uint64_t address : addresses) {
+    // Strings that can't be read are left out of the index
+    if (!content(address, value)) continue;
+
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(address);
+    hashes.emplace_back(Hash(value), id);
+    if (!grams || value.size() < 3) continue;
+
+    if (value.size() > kMaxGramLength) {
+      long_ids_.push_back(id);
+      continue;
+    }
+
+    string_grams.clear();
+    for (size_t i = 0; i + 3 <= value.size(); i++)
+      string_grams.push_back(Gram(value, i));
+    std::sort(string_grams.begin(), string_grams.end());
+    auto end = std::unique(string_grams.begin(), string_grams.end());
+
+    // Past the limit, keep indexing the hashes only
+    postings += end - string_grams.begin();
+    if (postings > kMaxGramPostings) {
+      grams = false;
+      too_many_grams_ = true;
+      std::vector<uint64_t>().swap(pairs);
+      std::vector<GramChunk>().swap(chunks);
+      std::vector<uint32_t>().swap(long_ids_);
+      continue;
+    }
+
+    for (auto it = string_grams.begin(); it != end; ++it)
+      pairs.push_back(static_cast<uint64_t>(*it) << 32 | id);
+    if (pairs.size() >= kChunkPairs) {
+      chunks.emplace_back();
+      BuildChunk(pairs, chunks.back());
+      pairs.clear();
+    }
+  }
+
+  std::sort(hashes.begin(), hashes.end());
+  hashes_.reserve(hashes.size());
+  hash_ids_.reserve(hashes.size());
+  for (const auto& hash : hashes) {
+    hashes_.push_back(hash.first);
+    hash_ids_.push_back(hash.second);
+  }
+
+  if (grams) {
+    if (!pairs.empty() || chunks.empty()) {
+      chunks.emplace_back();
+      BuildChunk(pairs, chunks.back());
+    }
+    std::vector<uint64_t>().swap(pairs);
+    MergeChunks(chunks, postings);
+  }
+
+  has_grams_ = grams;
+  built_ = true;
+}
+
+
+/* Posting lists of the sorted, unique `pairs`. Ids are pushed in order for
+ * each trigram, so posting lists come out sorted.
+ */
+void StringIndex::BuildChunk(std::vector<uint64_t>& pairs, GramChunk& chunk) {
+  std::sort(pairs.begin(), pairs.end());
+  chunk.ids.reserve(pairs.size());
+  for (size_t i = 0; i < pairs.size(); i++) {
+    uint32_t gram = static_cast<uint32_t>(pairs[i] >> 32);
+    if (chunk.keys.empty() || chunk.keys.back() != gram) {
+      chunk.keys.push_back(gram);
+      chunk.offsets.push_back(chunk.ids.size());
+    }
+    chunk.ids.push_back(static_cast<uint32_t>(pairs[i]));
+  }
+  chunk.offsets.push_back(chunk.ids.size());
+}
+
+
+/* Concatenates the posting lists of every trigram across `chunks`. Ids grow
+ * from one chunk to the next, so the lists stay sorted. Every chunk is
+ * released once merged.
+ */
+void StringIndex::MergeChunks(std::vector<GramChunk>& chunks,
+                              uint64_t postings) {
+  if (chunks.size() == 1) {
+    gram_keys_.swap(chunks[0].keys);
+    gram_offsets_.swap(chunks[0].offsets);
+    gram_ids_.swap(chunks[0].ids);
+    return;
+  }
+
+  for (const GramChunk& chunk : chunks)
+    gram_keys_.insert(gram_keys_.end(), chunk.keys.begin(), chunk.keys.end());
+  std::sort(gram_keys_.begin(), gram_keys_.end());
+  gram_keys_.erase(std::unique(gram_keys_.begin(), gram_keys_.end()),
+                   gram_keys_.end());
+
+  // Number of postings of every trigram, then their offsets
+  gram_offsets_.assign(gram_keys_.size() + 1, 0);
+  for (const GramChunk& chunk : chunks) {
+    size_t key = 0;
+    for (size_t i = 0; i < chunk.keys.size(); i++) {
+      while (gram_keys_[key] != chunk.keys[i]) key++;
+      gram_offsets_[key + 1] += chunk.offsets[i + 1] - chunk.offsets[i];
+    }
+  }
+  for (size_t key = 1; key < gram_offsets_.size(); key++)
+    gram_offsets_[key] += gram_offsets_[key - 1];
+
+  std::vector<uint64_t> next(gram_offsets_.begin(), gram_offsets_.end() - 1);
+  gram_ids_.resize(postings);
+  for (GramChunk& chunk : chunks) {
+    size_t key = 0;
+    for (size_t i = 0; i < chunk.keys.size(); i++) {
+      while (gram_keys_[key] != chunk.keys[i]) key++;
+      for (uint64_t j = chunk.offsets[i]; j < chunk.offsets[i + 1]; j++)
+        gram_ids_[next[key]++] = chunk.ids[j];
+    }
+    chunk = GramChunk();
+  }
+}
+
+
+void StringIndex::Clear() {
+  built_ = false;
+  has_grams_ = false;
+  too_many_grams_ = false;
+  strings_.clear();
+  hashes_.clear();
+  hash_ids_.clear();
+  gram_keys_.clear();
+  gram_offsets_.clear();
+  gram_ids_.clear();
+  long_ids_.clear();
+}
+
+
+void StringIndex::Save(ScanIndexWriter& writer) const {
+  writer.WriteU64(has_grams_ ? kGrams : too_many_grams_ ? kTooManyGrams : 0);
+  writer.WriteArray(strings_);
+  writer.WriteArray(hashes_);
+  writer.WriteArray(hash_ids_);
+  writer.WriteArray(gram_keys_);
+  writer.WriteArray(gram_offsets_);
+  writer.WriteArray(gram_ids_);
+  writer.WriteArray(long_ids_);
+}
+
+
+bool StringIndex::Load(ScanIndexReader& reader) {
+  Clear();
+
+  uint64_t grams_state = reader.ReadU64();
+  bool grams = grams_state == kGrams;
+  reader.ReadArray(strings_);
+  reader.ReadArray(hashes_);
+  reader.ReadArray(hash_ids_);
+  reader.ReadArray(gram_keys_);
+  reader.ReadArray(gram_offsets_);
+  reader.ReadArray(gram_ids_);
+  reader.ReadArray(long_ids_);
+
+  bool valid = !reader.failed() && grams_state <= kTooManyGrams &&
+               hashes_.size() == strings_.size() &&
+               hash_ids_.size() == strings_.size();
+  if (valid && grams) {
+    valid = gram_offsets_.size() == gram_keys_.size() + 1 &&
+            gram_offsets_[0] == 0 && gram_offsets_.back() == gram_ids_.size();
+  }
+  for (size_t i = 1; valid && i < gram_offsets_.size(); i++)
+    valid = gram_offsets_[i - 1] <= gram_offsets_[i];
+  for (uint32_t id : hash_ids_) valid = valid && id < strings_.size();
+  for (uint32_t id : gram_ids_) valid = valid && id < strings_.size();
+  for (uint32_t id : long_ids_) valid = valid && id < strings_.size();
+  if (!valid) {
+    Clear();
+    return false;
+  }
+
+  has_grams_ = grams;
+  too_many_grams_ = grams_state == kTooManyGrams;
+  built_ = true;
+  return true;
+}
+
+
+/* FNV-1a. Different strings can share a hash, so matches are checked
+ * against the contents.
+ */
+uint64_t StringIndex::Hash(const std::string& value) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : value) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+
+void StringIndex::FindEqual(const std::string& value,
+                            const ContentFunction& content,
+                            std::vector<uint64_t>& strings) const {
+  strings.clear();
+
+  std::string current;
+  auto range = std::equal_range(hashes_.begin(), hashes_.end(), Hash(value));
+  for (auto it = range.first; it != range.second; ++it) {
+    uint64_t address = strings_[hash_ids_[it - hashes_.begin()]];
+    if (content(address, current) && current == value)
+      strings.push_back(address);
+  }
+  std::sort(strings.begin(), strings.end());
+}
+
+
+void StringIndex::FindContaining(const std::string& value, bool prefix,
+                                 const ContentFunction& content,
+                                 std::vector<uint64_t>& strings) const {
+  strings.clear();
+
+  std::vector<uint32_t> candidates;
+  if (!has_grams_ || value.size() < 3) {
+    candidates.resize(strings_.size());
+    for (uint32_t id = 0; id < candidates.size(); id++) candidates[id] = id;
+  } else {
+    // Posting lists of the value's trigrams, shortest first so the
+    // intersection shrinks as fast as possible
+    std::vector<std::pair<uint64_t, uint64_t>> lists;
+    bool missing = false;
+    for (size_t i = 0; i + 3 <= value.size(); i++) {
+      auto it = std::lower_bound(gram_keys_.begin(), gram_keys_.end(),
+                                 Gram(value, i));
+      if (it == gram_keys_.end() || *it != Gram(value, i)) {
+        missing = true;
+        break;
+      }
+      size_t key = it - gram_keys_.begin();
+      lists.emplace_back(gram_offsets_[key], gram_offsets_[key + 1]);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const std::pair<uint64_t, uint64_t>& a,
+                 const std::pair<uint64_t, uint64_t>& b) {
+                uint64_t a_size = a.second - a.first;
+                uint64_t b_size = b.second - b.first;
+                return a_size < b_size || (a_size == b_size && a < b);
+              });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    if (!missing) {
+      candidates.assign(gram_ids_.begin() + lists[0].first,
+                        gram_ids_.begin() + lists[0].second);
+      std::vector<uint32_t> intersection;
+      for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+        intersection.clear();
+        std::set_intersection(candidates.begin(), candidates.end(),
+                              gram_ids_.begin() + lists[i].first,
+                              gram_ids_.begin() + lists[i].second,
+                              std::back_inserter(intersection));
+        candidates.swap(intersection);
+      }
+    }
+
+    std::vector<uint32_t> merged;
+    std::set_union(candidates.begin(), candidates.end(), long_ids_.begin(),
+                   long_ids_.end(), std::back_inserter(merged));
+    candidates.swap(merged);
+  }
+
+  // Trigrams only narrow the search down, check the contents
+  std::string current;
+  for (uint32_t id : candidates) {
+    if (!content(strings_[id], current)) continue;
+    bool found = prefix ? current.compare(0, value.size(), value) == 0
+                        : current.find(value) != std::string::npos;
+    if (found) strings.push_back(strings_[id]);
+  }
+}
+
+}  // namespace llnode
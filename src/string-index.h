@@ -0,0 +1,110 @@
+#ifndef SRC_STRING_INDEX_H_
+#define SRC_STRING_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "src/scan-index.h"
+
+namespace llnode {
+
+/* Index of the contents of the strings found by a heap scan.
+ *
+ * Every string is read once while building and only its hash is kept, so
+ * finding the strings equal to a value is a binary search. Optionally the
+ * trigrams of every string are indexed too, in compressed sparse row form:
+ * a string containing a value has all of its trigrams, so only the strings
+ * found in every posting list of the value's trigrams are read again to
+ * check. Strings longer than kMaxGramLength bytes aren't split in trigrams
+ * and are always checked. If the trigrams would take more than
+ * kMaxGramPostings postings only the hashes are kept, and substring
+ * searches read every string.
+ */
+class StringIndex {
+ public:
+  // Reads the contents of the string at `address`, false if it can't
+  typedef std::function<bool(uint64_t address, std::string& content)>
+      ContentFunction;
+
+  StringIndex() : built_(false), has_grams_(false), too_many_grams_(false) {}
+
+  void Build(const std::vector<uint64_t>& strings,
+             const ContentFunction& content, bool grams);
+  void Clear();
+
+  void Save(ScanIndexWriter& writer) const;
+  bool Load(ScanIndexReader& reader);
+
+  inline bool IsBuilt() const { return built_; }
+  inline bool HasGrams() const { return has_grams_; }
+  // True if trigrams were asked for but there were too many to index
+  inline bool HasTooManyGrams() const { return too_many_grams_; }
+  inline size_t size() const { return strings_.size(); }
+
+  /* Strings equal to `value`, sorted by address. Only the strings with the
+   * same hash are read.
+   */
+  void FindEqual(const std::string& value, const ContentFunction& content,
+                 std::vector<uint64_t>& strings) const;
+
+  /* Strings containing `value`, or starting with it if `prefix` is set,
+   * sorted by address. Every string is read if the index has no trigrams.
+   */
+  void FindContaining(const std::string& value, bool prefix,
+                      const ContentFunction& content,
+                      std::vector<uint64_t>& strings) const;
+
+  static uint64_t Hash(const std::string& value);
+
+ private:
+  static const size_t kMaxGramLength = 1024;
+  // What the index holds besides the hashes, as saved
+  static const uint64_t kGrams = 1;
+  static const uint64_t kTooManyGrams = 2;
+  // Trigram pairs collected before they are turned into posting lists
+  static const size_t kChunkPairs = 1 << 24;
+  // No trigrams are indexed past this many postings, i.e. 1GB of ids and
+  // twice that while the chunks are merged
+  static const uint64_t kMaxGramPostings = 1ULL << 28;
+
+  // Posting lists of the strings of a chunk, laid out like the index's
+  struct GramChunk {
+    std::vector<uint32_t> keys;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> ids;
+  };
+
+  static void BuildChunk(std::vector<uint64_t>& pairs, GramChunk& chunk);
+  void MergeChunks(std::vector<GramChunk>& chunks, uint64_t postings);
+
+  static inline uint32_t Gram(const std::string& value, size_t i) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(value[i])) << 16 |
+           static_cast<uint32_t>(static_cast<uint8_t>(value[i + 1])) << 8 |
+           static_cast<uint32_t>(static_cast<uint8_t>(value[i + 2]));
+  }
+
+  bool built_;
+  bool has_grams_;
+  bool too_many_grams_;
+
+  // Addresses of the indexed strings, a string's id is its position here
+  std::vector<uint64_t> strings_;
+
+  // Hashes of the contents, sorted, and the id of each string
+  std::vector<uint64_t> hashes_;
+  std::vector<uint32_t> hash_ids_;
+
+  // Posting list of the ids of the strings containing each trigram
+  std::vector<uint32_t> gram_keys_;
+  std::vector<uint64_t> gram_offsets_;
+  std::vector<uint32_t> gram_ids_;
+  // Strings too long to have their trigrams indexed
+  std::vector<uint32_t> long_ids_;
+};
+
+}  // namespace llnode
+
+#endif  // SRC_STRING_INDEX_H_
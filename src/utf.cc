@@ -0,0 +1,127 @@
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "src/utf.h"
+
+namespace llnode {
+
+/* Converts the ASCII units at the start of `in`, a whole vector at a time,
+ * and returns how many were converted. Stops at the first vector with a
+ * non-ASCII unit in it.
+ */
+static size_t AsciiToUtf8(const char16_t* in, size_t length, char* out) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i mask = _mm256_set1_epi16(static_cast<int16_t>(0xff80));
+  for (; i + 32 <= length; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 16));
+    if (!_mm256_testz_si256(_mm256_or_si256(a, b), mask)) break;
+
+    // Packing works on each 128-bit lane, put the quarters back in order
+    __m256i packed =
+        _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  const __m128i mask128 = _mm_set1_epi16(static_cast<int16_t>(0xff80));
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= length; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), mask128);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) != 0xffff) break;
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_packus_epi16(a, b));
+  }
+#endif
+  return i;
+}
+
+
+size_t Utf16ToUtf8(const char16_t* in, size_t length, char* out) {
+  // Units converted one at a time before trying vectors again, so text
+  // with few ASCII runs doesn't pay for a failed check on every character
+  static const size_t kScalarRun = 16;
+
+  char* start = out;
+  size_t i = 0;
+  while (i < length) {
+    size_t ascii = AsciiToUtf8(in + i, length - i, out);
+    i += ascii;
+    out += ascii;
+
+    size_t end = i + kScalarRun < length ? i + kScalarRun : length;
+    while (i < end) {
+      uint32_t c = in[i++];
+      if (c < 0x80) {
+        *out++ = static_cast<char>(c);
+        continue;
+      }
+      if (c < 0x800) {
+        *out++ = static_cast<char>(0xc0 | (c >> 6));
+        *out++ = static_cast<char>(0x80 | (c & 0x3f));
+        continue;
+      }
+
+      if (c >= 0xd800 && c <= 0xdfff) {
+        uint32_t low = i < length ? in[i] : 0;
+        if (c <= 0xdbff && low >= 0xdc00 && low <= 0xdfff) {
+          // A pair may cross the end of the run, it is still read whole
+          i++;
+          c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+          *out++ = static_cast<char>(0xf0 | (c >> 18));
+          *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+          *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+          *out++ = static_cast<char>(0x80 | (c & 0x3f));
+          continue;
+        }
+        c = 0xfffd;
+      }
+
+      *out++ = static_cast<char>(0xe0 | (c >> 12));
+      *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+      *out++ = static_cast<char>(0x80 | (c & 0x3f));
+    }
+  }
+
+  return out - start;
+}
+
+
+void Utf16ToLowBytes(const char16_t* in, size_t length, char* out) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i mask = _mm256_set1_epi16(0xff);
+  for (; i + 32 <= length; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 16));
+    __m256i packed = _mm256_packus_epi16(_mm256_and_si256(a, mask),
+                                         _mm256_and_si256(b, mask));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_permute4x64_epi64(packed, 0xd8));
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  const __m128i mask128 = _mm_set1_epi16(0xff);
+  for (; i + 16 <= length; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_packus_epi16(_mm_and_si128(a, mask128),
+                                      _mm_and_si128(b, mask128)));
+  }
+#endif
+  for (; i < length; i++) out[i] = static_cast<char>(in[i] & 0xff);
+}
+
+}  // namespace llnode
@@ -0,0 +1,27 @@
+#ifndef SRC_UTF_H_
+#define SRC_UTF_H_
+
+#include <stddef.h>
+
+namespace llnode {
+
+/* Most UTF-8 bytes Utf16ToUtf8() writes for `length` code units: three per
+ * unit, a surrogate pair takes four bytes for two units.
+ */
+inline size_t MaxUtf8Length(size_t length) { return length * 3; }
+
+/* Converts `length` UTF-16 code units to UTF-8 into `out`, which must have
+ * room for MaxUtf8Length(length) bytes, and returns the number of bytes
+ * written. Unpaired surrogates become U+FFFD. Runs of ASCII characters are
+ * converted with SSE2, or AVX2 if the build targets it.
+ */
+size_t Utf16ToUtf8(const char16_t* in, size_t length, char* out);
+
+/* Keeps the low byte of each of `length` code units, one byte per unit
+ * into `out`.
+ */
+void Utf16ToLowBytes(const char16_t* in, size_t length, char* out);
+
+}  // namespace llnode
+
+#endif  // SRC_UTF_H_
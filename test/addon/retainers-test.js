@@ -0,0 +1,71 @@
+'use strict';
+
+const LLNode = require('../../');
+
+const debug = process.env.TEST_LLNODE_DEBUG ?
+  console.log.bind(console) : () => { };
+
+const common = require('../common');
+const tape = require('tape');
+
+tape('llnode API getRetainersAtAddress', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+    t.end();
+  } else {
+    common.saveCore({
+      scenario: 'inspect-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+      t.end();
+    });
+  }
+});
+
+function test(executable, core, t) {
+  debug(`Loading core dump: ${core}, executable: ${executable}`);
+  const llnode = new LLNode(core, executable);
+  llnode.loadCore();
+
+  const zlibType = llnode.getJsObjects().object_list.find((type) => {
+    return type.name === 'Zlib';
+  });
+  t.ok(zlibType, 'Zlib should be in getJsObjects');
+
+  const zlib = llnode.getJsInstances(zlibType.index).instance_list[0];
+  debug('Zlib instance', zlib);
+  t.ok(/^0x[0-9a-f]+$/.test(zlib.address), 'Zlib instance should have an address');
+
+  const paths = llnode.getRetainersAtAddress(zlib.address);
+  debug('Retainers', paths);
+  t.ok(Array.isArray(paths), 'getRetainersAtAddress should return an array');
+  t.ok(paths.length > 0 && paths.length <= 5, 'Should find at most 5 paths');
+  for (const path of paths) {
+    t.equal(typeof path.root, 'string', 'path.root should be a string');
+    t.equal(parseInt(path.objects[0], 16), parseInt(zlib.address, 16),
+      'Paths should start at the object itself');
+    t.ok(path.objects.length <= 17,
+      'Paths should follow at most 16 references by default');
+  }
+
+  const limited = llnode.getRetainersAtAddress(zlib.address,
+    { depth: 1, paths: 1 });
+  t.ok(limited.length <= 1, 'options.paths should limit the number of paths');
+  for (const path of limited) {
+    t.ok(path.objects.length <= 2,
+      'options.depth should limit the length of paths');
+  }
+
+  t.throws(() => llnode.getRetainersAtAddress('zlib'), TypeError,
+    'Should reject invalid addresses');
+  t.throws(() => llnode.getRetainersAtAddress(zlib.address, { depth: -1 }),
+    TypeError, 'Should reject negative depths');
+  t.throws(() => llnode.getRetainersAtAddress(zlib.address,
+    { paths: Infinity }), TypeError, 'Should reject non-finite path counts');
+}
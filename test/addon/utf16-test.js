@@ -0,0 +1,96 @@
+'use strict';
+
+const LLNode = require('../../');
+
+const debug = process.env.TEST_LLNODE_DEBUG ?
+  console.log.bind(console) : () => { };
+
+const common = require('../common');
+const tape = require('tape');
+
+// Two-byte strings of inspect-scenario.js: surrogate pairs across the 16
+// and 32 unit vectors, unpaired surrogates and a long run of ASCII characters.
+const utf16Strings = {
+  'utf16-split-16': 'x'.repeat(15) + '\uD83D\uDE01' + 'y'.repeat(16),
+  'utf16-split-32': 'x'.repeat(31) + '\uD83D\uDE01' + 'y'.repeat(32),
+  'utf16-unpaired': 'high \uD801 low \uDC01 end \uD83D',
+  'utf16-ascii-run': 'z'.repeat(70) + '\u00e9\u4f60' + 'z'.repeat(40)
+};
+
+// The API shows the first 100 UTF-16 code units of a string
+const kDisplayLength = 100;
+
+tape('llnode API two-byte strings', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+    t.end();
+  } else {
+    common.saveCore({
+      scenario: 'inspect-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+      t.end();
+    });
+  }
+});
+
+// Address of the value of property `key` of the inspected object `object`
+function findProperty(object, key) {
+  for (const property of object.properties || []) {
+    if (property[key] !== undefined)
+      return property[key].address;
+  }
+  return null;
+}
+
+function test(executable, core, t) {
+  debug(`Loading core dump: ${core}, executable: ${executable}`);
+  const llnode = new LLNode(core, executable);
+  llnode.loadCore();
+
+  const classType = llnode.getJsObjects().object_list.find((type) => {
+    return type.name === 'Class';
+  });
+  t.ok(classType, 'Class should be in getJsObjects');
+
+  const instance = llnode.getJsInstances(classType.index).instance_list[0];
+  const c = llnode.inspectJsObjectAtAddress(instance.address);
+  const hashmapAddress = findProperty(c, 'hashmap');
+  t.ok(hashmapAddress, 'Class instance should have a hashmap');
+  const hashmap = llnode.inspectJsObjectAtAddress(hashmapAddress);
+
+  for (const key of Object.keys(utf16Strings)) {
+    const address = findProperty(hashmap, key);
+    t.ok(address, `hashmap.${key} should exist`);
+
+    const str = llnode.inspectJsObjectAtAddress(address);
+    debug(key, str);
+    const value = utf16Strings[key];
+    // Unpaired surrogates become U+FFFD, as with Buffer.from()
+    const expected = value.length > kDisplayLength ?
+      Buffer.from(value.slice(0, kDisplayLength)).toString() + '...' :
+      Buffer.from(value).toString();
+    t.equal(str.total_length, value.length,
+      `hashmap.${key} should have the right length`);
+    t.equal(str.display, expected,
+      `hashmap.${key} should be converted to UTF-8`);
+    t.equal(str.current, Math.min(value.length, kDisplayLength),
+      `hashmap.${key} should be paged in UTF-16 code units`);
+    t.equal(str.end, value.length <= kDisplayLength,
+      `hashmap.${key} should end with its last code unit`);
+  }
+
+  // A page ending inside a surrogate pair takes the whole pair
+  const address = findProperty(hashmap, 'utf16-split-16');
+  const page = llnode.inspectJsObjectAtAddress(address,
+                                               { current: 15, limit: 1 });
+  t.equal(page.display, '\uD83D\uDE01...', 'Page should hold the whole pair');
+  t.equal(page.current, 17, 'Next page should start after the pair');
+  t.equal(page.end, false, 'Page should not be the last one');
+}
@@ -151,7 +151,7 @@ function Session(options) {
   EventEmitter.call(this);
   const timeout = parseInt(process.env.TEST_TIMEOUT) || 10000;
   const lldbBin = process.env.TEST_LLDB_BINARY || 'lldb';
-  const env = Object.assign({}, process.env);
+  const env = Object.assign({}, process.env, options.env);
 
   if (options.ranges)
     env.LLNODE_RANGESFILE = options.ranges;
@@ -275,13 +275,15 @@ exports.saveCore = function saveCore(options, cb) {
   }
 }
 
-// Load the core dump with the executable
-Session.loadCore = function loadCore(executable, core, cb) {
+// Load the core dump with the executable, `env` is added to the environment
+// of lldb
+Session.loadCore = function loadCore(executable, core, cb, env) {
   const ranges = process.env.LLNODE_NO_RANGES ? undefined : core + '.ranges';
   const sess = new Session({
     executable: executable,
     core: core,
-    ranges: ranges
+    ranges: ranges,
+    env: env
   });
 
   sess.timeoutAfter(exports.loadCoreTimeout);
@@ -35,9 +35,26 @@ function closure() {
   c.hashmap['some-key'] = 42;
   c.hashmap['other-key'] = 'ohai';
   c.hashmap['utf8-string'] = '你是个好人';
+  // Flat two-byte strings with surrogate pairs across the 16 and 32 unit
+  // vectors of the UTF-16 conversions, unpaired surrogates, and a long run
+  // of ASCII characters. Keep in sync with test/addon/utf16-test.js and
+  // test/plugin/inspect-test.js.
+  c.hashmap['utf16-split-16'] =
+      makeThin('x'.repeat(15) + '\uD83D\uDE01', 'y'.repeat(16));
+  c.hashmap['utf16-split-32'] =
+      makeThin('x'.repeat(31) + '\uD83D\uDE01', 'y'.repeat(32));
+  c.hashmap['utf16-unpaired'] =
+      makeThin('high \uD801 low \uDC01', ' end \uD83D');
+  c.hashmap['utf16-ascii-run'] =
+      makeThin('z'.repeat(70) + '\u00e9\u4f60', 'z'.repeat(40));
   c.hashmap['cons-string'] =
       'this could be a bit smaller, but v8 wants big str.';
   c.hashmap['cons-string'] += c.hashmap['cons-string'];
+  // A left-deep rope, as built by appending to a string in a loop.
+  let deepCons = 'a deep cons string: ';
+  for (let i = 0; i < 1000; i++)
+    deepCons += i + ',';
+  c.hashmap['deep-cons-string'] = deepCons;
   c.hashmap['internalized-string'] = 'foobar';
   // This thin string points to the previous 'foobar'.
   c.hashmap['thin-string'] = makeThin('foo', 'bar');
@@ -49,6 +66,12 @@ function closure() {
   // which seems to be 13 so our string is 26.
   c.hashmap['sliced-externalized-string'] =
       c.hashmap['externalized-string'].substring(10,36);
+  // Node externalizes the strings of large buffers itself, with its own
+  // resource. Keep in sync with test/plugin/findstrings-test.js.
+  c.hashmap['buffer-external-string'] =
+      Buffer.alloc(2e6, 'llnode external ').toString('latin1');
+  c.hashmap['sliced-buffer-external-string'] =
+      c.hashmap['buffer-external-string'].slice(7, 38);
 
   c.hashmap['array'] = [true, 1, undefined, null, 'test', Class];
   c.hashmap['long-array'] = new Array(20).fill(5);
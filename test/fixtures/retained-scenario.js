@@ -0,0 +1,21 @@
+'use strict';
+
+// A chain of objects only reachable through each other, so every object
+// dominates the next one:
+//   exports.holder -> RetainedOuter -> RetainedMiddle -> 2 x RetainedLeaf
+function RetainedLeaf(value) {
+  this.value = value;
+}
+
+function RetainedMiddle() {
+  this.first = new RetainedLeaf(1);
+  this.second = new RetainedLeaf(2);
+}
+
+function RetainedOuter() {
+  this.middle = new RetainedMiddle();
+}
+
+exports.holder = new RetainedOuter();
+
+uncaughtException();
@@ -0,0 +1,139 @@
+'use strict';
+
+const tape = require('tape');
+const common = require('../common');
+const versionMark = common.versionMark;
+
+tape('v8 findstrings and findrefs -s', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+  } else {
+    common.saveCore({
+      scenario: 'inspect-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+    });
+  }
+});
+
+function test(executable, core, t) {
+  const sess = common.Session.loadCore(executable, core, (err) => {
+    t.error(err);
+    t.ok(true, 'Loaded core');
+
+    sess.send('v8 findstrings ohai');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    const output = lines.join('\n');
+
+    t.ok(/0x[0-9a-f]+:<String "ohai", length=4>/.test(output),
+         'Should find an equal string');
+    t.notOk(/<String "(?!ohai")/.test(output),
+            'Should only find equal strings');
+    const count = output.match(/(\d+) strings found/);
+    t.ok(count && +count[1] > 0, 'Should print the number of strings');
+
+    sess.send('v8 findstrings -p "this could be"');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    const output = lines.join('\n');
+
+    t.ok(/<String "this could be a \.\.\.", length=50>/.test(output),
+         'findstrings -p should find strings starting with the text');
+    t.notOk(/<String "(?!this could be)/.test(output),
+            'findstrings -p should only find strings starting with the text');
+
+    sess.send('v8 findstrings -c "a bit smaller"');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+
+    const output = lines.join('\n');
+    t.ok(/<String "this could be a \.\.\.", length=50>/.test(output),
+         'findstrings -c should find strings containing the text');
+
+    sess.send('v8 findstrings a bit smaller');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+
+    t.ok(/Extra search parameter or unquoted string specified/.test(
+             lines.join('\n')),
+         'findstrings should reject unquoted text');
+
+    // The external string of a buffer, see inspect-scenario.js
+    sess.send('v8 findstrings -p "llnode external llnode"');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    const output = lines.join('\n');
+
+    t.ok(/<String "llnode external \.\.\.", length=2000000>/.test(output),
+         'findstrings -p should find external strings');
+
+    sess.send('v8 findstrings "external llnode external llnode"');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+
+    t.ok(/<String "external llnode \.\.\.", length=31>/.test(lines.join('\n')),
+         'findstrings should find strings sliced from external strings');
+
+    sess.send('v8 findrefs -s ohai');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+
+    t.ok(/: Object\.other-key=0x[0-9a-f]+ 'ohai'/.test(lines.join('\n')),
+         'findrefs -s should find the property holding the string');
+
+    sess.send('v8 findrefs -s ohai foobar');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    const output = lines.join('\n');
+
+    t.ok(/References to 'ohai':/.test(output) &&
+             /References to 'foobar':/.test(output),
+         'findrefs -s should print the references to each string');
+    t.ok(/\.other-key=0x[0-9a-f]+ 'ohai'/.test(output),
+         'findrefs -s should find the first string');
+    t.ok(/\.internalized-string=0x[0-9a-f]+ 'foobar'/.test(output),
+         'findrefs -s should find the second string');
+
+    sess.quit();
+    t.end();
+  });
+}
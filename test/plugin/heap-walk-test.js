@@ -0,0 +1,74 @@
+'use strict';
+
+const tape = require('tape');
+const common = require('../common');
+const versionMark = common.versionMark;
+
+tape('v8 findjsobjects with LLNODE_HEAP_WALK', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+  } else {
+    common.saveCore({
+      scenario: 'inspect-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+    });
+  }
+});
+
+// Instance counts of `v8 findjsobjects`, by type name, and the lines that
+// aren't part of the table
+function findObjects(executable, core, env, t, cb) {
+  const sess = common.Session.loadCore(executable, core, (err) => {
+    t.error(err);
+    t.ok(true, 'Loaded core');
+
+    sess.send('v8 findjsobjects');
+    // Just a separator
+    sess.send('version');
+  }, env);
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+
+    const counts = new Map();
+    const other = [];
+    for (const line of lines) {
+      const match = line.match(/^ +(\d+) +\d+ (\S.*)$/);
+      if (match)
+        counts.set(match[2], +match[1]);
+      else
+        other.push(line);
+    }
+
+    sess.quit();
+    cb(counts, other);
+  });
+}
+
+function test(executable, core, t) {
+  findObjects(executable, core, {}, t, (scanned) => {
+    t.ok(scanned.get('Class') > 0, 'Class should be in findjsobjects');
+
+    const env = { LLNODE_HEAP_WALK: 'true' };
+    findObjects(executable, core, env, t, (walked, other) => {
+      // Objects the walk couldn't size are reported, name their types
+      for (const line of other) {
+        if (/^Heap walk skipped/.test(line))
+          t.comment(line);
+      }
+
+      for (const type of [ 'Class', 'Zlib' ]) {
+        t.equal(walked.get(type), scanned.get(type),
+                `The heap walk should find every ${type}`);
+      }
+      t.end();
+    });
+  });
+}
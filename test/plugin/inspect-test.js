@@ -103,6 +103,37 @@ const hashMapTests = {
       });
     }]
   },
+  // .deep-cons-string=0x000003df9cbe7601:<String "a deep cons stri...", length=3910>,
+  'deep-cons-string': {
+    re: /.deep-cons-string=(0x[0-9a-f]+):<String "a deep cons stri\.\.\.", length=3910>/,
+    desc: '.deep-cons-string deep ConsString property',
+    validators: [(t, sess, addresses, name, cb) => {
+      const address = addresses[name];
+      sess.send(`v8 inspect --string-length 30 ${address}`);
+
+      sess.linesUntil(/length=\d+>/, (err, lines) => {
+        if (err) return cb(err);
+        lines = lines.join('\n');
+        t.ok(lines.includes('"a deep cons string: 0,1,2,3,4,..."'),
+            'hashmap.deep-cons-string should have the right prefix');
+        cb(null);
+      });
+    }, (t, sess, addresses, name, cb) => {
+      const address = addresses[name];
+      sess.send(`v8 inspect -F ${address}`);
+
+      sess.linesUntil(/length=\d+>/, (err, lines) => {
+        if (err) return cb(err);
+        lines = lines.join('\n');
+        let expected = 'a deep cons string: ';
+        for (let i = 0; i < 1000; i++)
+          expected += i + ',';
+        t.ok(lines.includes(`"${expected}"`),
+            'hashmap.deep-cons-string should have the right content');
+        cb(null);
+      });
+    }]
+  },
   // .internalized-string=0x000036eccf7bda89:<String: "foobar">,
   'internalized-string': {
     re: /.internalized-string=(0x[0-9a-f]+):<String: "foobar">/,
@@ -136,6 +167,41 @@ const hashMapTests = {
     re: /.sliced-externalized-string=(0x[0-9a-f]+):<String: "\(external\)">/,
     desc: '.sliced-externalized-string Sliced ExternalString property'
   },
+  // .buffer-external-string=0x000003df9cbe7801:<String "llnode external ...", length=2000000>,
+  'buffer-external-string': {
+    re: /.buffer-external-string=(0x[0-9a-f]+):<String "llnode external \.\.\.", length=2000000>/,
+    desc: '.buffer-external-string ExternalString property of Node',
+    validator(t, sess, addresses, name, cb) {
+      const address = addresses[name];
+      sess.send(`v8 inspect --string-length 40 ${address}`);
+
+      sess.linesUntil(/length=\d+>/, (err, lines) => {
+        if (err) return cb(err);
+        lines = lines.join('\n');
+        const expected = 'llnode external '.repeat(3).slice(0, 40) + '...';
+        t.ok(lines.includes(`"${expected}", length=2000000>`),
+            'hashmap.buffer-external-string should have the right content');
+        cb(null);
+      });
+    }
+  },
+  // .sliced-buffer-external-string=0x000003df9cbe7821:<String "external llnode ...", length=31>,
+  'sliced-buffer-external-string': {
+    re: /.sliced-buffer-external-string=(0x[0-9a-f]+):<String "external llnode \.\.\.", length=31>/,
+    desc: '.sliced-buffer-external-string Sliced ExternalString property of Node',
+    validator(t, sess, addresses, name, cb) {
+      const address = addresses[name];
+      sess.send(`v8 inspect -F ${address}`);
+
+      sess.linesUntil(/length=\d+>/, (err, lines) => {
+        if (err) return cb(err);
+        lines = lines.join('\n');
+        t.ok(lines.includes('"external llnode external llnode", length=31>'),
+            'hashmap.sliced-buffer-external-string should have the right content');
+        cb(null);
+      });
+    }
+  },
   // .error=0x0000392d5d661119:<Object: Error>
   'error': {
     re: /.error=(0x[0-9a-f]+):<Object: Error>/,
@@ -351,6 +417,40 @@ const hashMapTests = {
   }
 };
 
+// Two-byte strings of inspect-scenario.js: surrogate pairs across the 16
+// and 32 unit vectors, unpaired surrogates and a long run of ASCII characters.
+const utf16Strings = {
+  'utf16-split-16': 'x'.repeat(15) + '\uD83D\uDE01' + 'y'.repeat(16),
+  'utf16-split-32': 'x'.repeat(31) + '\uD83D\uDE01' + 'y'.repeat(32),
+  'utf16-unpaired': 'high \uD801 low \uDC01 end \uD83D',
+  'utf16-ascii-run': 'z'.repeat(70) + '\u00e9\u4f60' + 'z'.repeat(40)
+};
+
+for (const key of Object.keys(utf16Strings)) {
+  hashMapTests[key] = {
+    re: new RegExp(`.${key}=(0x[0-9a-f]+):<String "`),
+    desc: `.${key} two-byte String property`,
+    validator(t, sess, addresses, name, cb) {
+      const address = addresses[name];
+      sess.send(`v8 inspect -F ${address}`);
+
+      sess.linesUntil(/length=\d+>/, (err, lines) => {
+        if (err) return cb(err);
+        lines = lines.join('\n');
+        // v8 inspect keeps the low byte of every UTF-16 code unit
+        const value = utf16Strings[name];
+        const bytes = [];
+        for (let i = 0; i < value.length; i++)
+          bytes.push(value.charCodeAt(i) & 0xff);
+        const expected = Buffer.from(bytes).toString();
+        t.ok(lines.includes(`"${expected}", length=${value.length}>`),
+            `hashmap.${name} should have the right content`);
+        cb(null);
+      });
+    }
+  };
+}
+
 const contextTests = {
   'previous': {
     re: /\(previous\)=(0x[0-9a-f]+)[^\n]+/,
@@ -0,0 +1,126 @@
+'use strict';
+
+const tape = require('tape');
+const common = require('../common');
+const versionMark = common.versionMark;
+
+tape('v8 retained and findjsobjects -r', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+  } else {
+    common.saveCore({
+      scenario: 'retained-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+    });
+  }
+});
+
+function findInstance(lines, type) {
+  const re = new RegExp(`(0x[0-9a-f]+):<Object: ${type}>`, 'i');
+  for (const line of lines) {
+    const match = line.match(re);
+    if (match)
+      return match[1];
+  }
+  return null;
+}
+
+function test(executable, core, t) {
+  const sess = common.Session.loadCore(executable, core, (err) => {
+    t.error(err);
+    t.ok(true, 'Loaded core');
+
+    sess.send('v8 findjsobjects -r');
+    // Just a separator
+    sess.send('version');
+  });
+
+  // Total sizes of every type, by name
+  const sizes = new Map();
+  const retained = new Map();
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    t.ok(/Instances +Total Size +Retained Size Name/.test(lines.join('\n')),
+         'findjsobjects -r should print retained sizes');
+
+    for (const line of lines) {
+      const match = line.match(/^ +(\d+) +(\d+) +(\d+) (Retained\w+)$/);
+      if (!match)
+        continue;
+      sizes.set(match[4], { count: +match[1], total: +match[2] });
+      retained.set(match[4], +match[3]);
+    }
+    t.equal(sizes.get('RetainedOuter').count, 1, 'One RetainedOuter');
+    t.equal(sizes.get('RetainedMiddle').count, 1, 'One RetainedMiddle');
+    t.equal(sizes.get('RetainedLeaf').count, 2, 'Two RetainedLeaf');
+
+    // Leaves only hold Smis, so they retain just themselves
+    t.equal(retained.get('RetainedLeaf'), sizes.get('RetainedLeaf').total,
+            'RetainedLeaf should retain its own size');
+    t.equal(retained.get('RetainedMiddle'),
+            sizes.get('RetainedMiddle').total +
+                sizes.get('RetainedLeaf').total,
+            'RetainedMiddle should retain the leaves');
+    t.equal(retained.get('RetainedOuter'),
+            sizes.get('RetainedOuter').total + retained.get('RetainedMiddle'),
+            'RetainedOuter should retain the whole chain');
+
+    sess.send('v8 findjsinstances RetainedOuter');
+    sess.send('v8 findjsinstances RetainedMiddle');
+    // Just a separator
+    sess.send('version');
+  });
+
+  let outer;
+  let middle;
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    outer = findInstance(lines, 'RetainedOuter');
+    middle = findInstance(lines, 'RetainedMiddle');
+    t.ok(outer, 'RetainedOuter should be in findjsinstances');
+    t.ok(middle, 'RetainedMiddle should be in findjsinstances');
+
+    sess.send(`v8 retained ${middle}`);
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    const output = lines.join('\n');
+
+    const self = output.match(
+        new RegExp(`^${middle} RetainedMiddle, retained size (\\d+)$`, 'm'));
+    t.ok(self, 'Should print the object and its retained size');
+    t.equal(+self[1], retained.get('RetainedMiddle'),
+            'Retained size should match findjsobjects -r');
+
+    const shallow = output.match(/^Shallow size (\d+)$/m);
+    t.ok(shallow, 'Should print the shallow size');
+    t.equal(+shallow[1], sizes.get('RetainedMiddle').total,
+            'Shallow size should match findjsobjects');
+
+    const dominator = output.match(
+        /^Immediate dominator: (0x[0-9a-f]+) RetainedOuter, retained size (\d+)$/m);
+    t.ok(dominator, 'RetainedOuter should be the immediate dominator');
+    t.equal(dominator[1], outer, 'Immediate dominator address');
+    t.equal(+dominator[2], retained.get('RetainedOuter'),
+            'Immediate dominator retained size');
+
+    t.ok(/^Dominates 2 objects, largest first:$/m.test(output),
+         'RetainedMiddle should dominate the two leaves');
+    const leaves = output.match(
+        /^ +0x[0-9a-f]+ RetainedLeaf, retained size \d+$/mg);
+    t.equal(leaves && leaves.length, 2, 'Should list both leaves');
+
+    sess.quit();
+    t.end();
+  });
+}
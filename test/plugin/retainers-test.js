@@ -0,0 +1,80 @@
+'use strict';
+
+const tape = require('tape');
+const common = require('../common');
+const versionMark = common.versionMark;
+
+tape('v8 retainers', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+  } else {
+    common.saveCore({
+      scenario: 'inspect-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+    });
+  }
+});
+
+function test(executable, core, t) {
+  const sess = common.Session.loadCore(executable, core, (err) => {
+    t.error(err);
+    t.ok(true, 'Loaded core');
+
+    sess.send('v8 findjsinstances Zlib');
+    // Just a separator
+    sess.send('version');
+  });
+
+  let zlib;
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    for (let i = lines.length - 1; i >= 0; i--) {
+      const match = lines[i].match(/(0x[0-9a-f]+):<Object: Zlib>/i);
+      if (match) {
+        zlib = match[1];
+        break;
+      }
+    }
+    t.ok(zlib, 'Zlib should be in findjsinstances');
+
+    sess.send(`v8 retainers ${zlib}`);
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    const output = lines.join('\n');
+
+    t.ok(/Path 1, \d+ references, ends at .+:/.test(output),
+         'Should print at least one path');
+    const first = new RegExp(`^ +${zlib} Zlib$`, 'mi');
+    t.ok(first.test(output), 'Paths should start at the object itself');
+    t.ok(/<- 0x[0-9a-f]+ .*(\._handle|\.holder|\[1\])$/m.test(output),
+         'Should name the reference to the object');
+
+    sess.send(`v8 retainers -p 1 -d 1 ${zlib}`);
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    const output = lines.join('\n');
+
+    t.notOk(/Path 2,/.test(output), '-p should limit the number of paths');
+    t.ok(/Path 1, [01] references|No retainer paths found within 1 references/
+             .test(output),
+         '-d should limit the length of paths');
+
+    sess.quit();
+    t.end();
+  });
+}
@@ -0,0 +1,132 @@
+'use strict';
+
+const fs = require('fs');
+const tape = require('tape');
+const common = require('../common');
+const versionMark = common.versionMark;
+
+tape('v8 findjsobjects with LLNODE_SCAN_INDEX', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+  } else {
+    common.saveCore({
+      scenario: 'inspect-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+    });
+  }
+});
+
+// Output of findjsobjects, findjsinstances and findrefs in a new session,
+// along with the debug messages of the scan index
+function scan(executable, core, t, cb) {
+  // Indexes are only used when the core file is mapped
+  const env = {
+    LLNODE_COREFILE: core,
+    LLNODE_SCAN_INDEX: 'true',
+    LLNODE_DEBUG: 'true'
+  };
+  const output = {};
+  const debug = [];
+
+  const sess = common.Session.loadCore(executable, core, (err) => {
+    t.error(err);
+    t.ok(true, 'Loaded core');
+
+    sess.send('v8 findjsobjects');
+    // Just a separator
+    sess.send('version');
+  }, env);
+
+  sess.stderr.on('line', (line) => {
+    if (/scan index/i.test(line))
+      debug.push(line);
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    output.objects = lines;
+
+    sess.send('v8 findjsinstances Zlib');
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    output.instances = lines;
+
+    const match = lines.join('\n').match(/(0x[0-9a-f]+):<Object: Zlib>/i);
+    t.ok(match, 'Zlib should be in findjsinstances');
+    if (match)
+      sess.send(`v8 findrefs ${match[1]}`);
+    // Just a separator
+    sess.send('version');
+  });
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+    output.refs = lines;
+
+    sess.quit();
+    cb(output, debug.join('\n'));
+  });
+}
+
+function test(executable, core, t) {
+  const index = core + '.llnode-index';
+  if (fs.existsSync(index))
+    fs.unlinkSync(index);
+
+  scan(executable, core, t, (scanned, debug) => {
+    t.ok(/Saved scan index/.test(debug), 'The scan should be saved');
+    t.ok(fs.existsSync(index), 'The scan index should be next to the core');
+
+    scan(executable, core, t, (loaded, debug) => {
+      t.ok(/Loaded scan index/.test(debug),
+           'The next session should load the index instead of scanning');
+      t.deepEqual(loaded, scanned,
+                  'The loaded index should give the same results');
+
+      // The key follows the magic and the version, change the size of the
+      // core it was built from
+      const fd = fs.openSync(index, 'r+');
+      const size = Buffer.alloc(8);
+      fs.readSync(fd, size, 0, 8, 16);
+      size[0] ^= 1;
+      fs.writeSync(fd, size, 0, 8, 16);
+      fs.closeSync(fd);
+
+      scan(executable, core, t, (rescanned, debug) => {
+        t.ok(/built from another core/.test(debug),
+             'An index of another core should be ignored');
+        t.ok(!/Loaded scan index/.test(debug) &&
+             /Saved scan index/.test(debug),
+             'An index of another core should be rebuilt');
+        t.deepEqual(rescanned, scanned,
+                    'A new scan should give the same results');
+
+        fs.truncateSync(index, Math.floor(fs.statSync(index).size / 2));
+
+        scan(executable, core, t, (rescanned, debug) => {
+          t.ok(/Ignoring invalid scan index/.test(debug),
+               'A truncated index should be ignored');
+          t.ok(!/Loaded scan index/.test(debug) &&
+               /Saved scan index/.test(debug),
+               'A truncated index should be rebuilt');
+          t.deepEqual(rescanned, scanned,
+                      'A new scan should give the same results');
+
+          fs.unlinkSync(index);
+          t.end();
+        });
+      });
+    });
+  });
+}
@@ -0,0 +1,72 @@
+'use strict';
+
+const tape = require('tape');
+const common = require('../common');
+const versionMark = common.versionMark;
+
+tape('v8 findjsobjects with LLNODE_SCAN_THREADS', (t) => {
+  t.timeoutAfter(common.saveCoreTimeout);
+
+  // Use prepared core and executable to test
+  if (process.env.LLNODE_CORE && process.env.LLNODE_NODE_EXE) {
+    test(process.env.LLNODE_NODE_EXE, process.env.LLNODE_CORE, t);
+  } else {
+    common.saveCore({
+      scenario: 'inspect-scenario.js'
+    }, (err) => {
+      t.error(err);
+      t.ok(true, 'Saved core');
+
+      test(process.execPath, common.core, t);
+    });
+  }
+});
+
+// Instance counts and total sizes of `v8 findjsobjects`, by type name
+function findObjects(executable, core, env, t, cb) {
+  const sess = common.Session.loadCore(executable, core, (err) => {
+    t.error(err);
+    t.ok(true, 'Loaded core');
+
+    sess.send('v8 findjsobjects');
+    // Just a separator
+    sess.send('version');
+  }, env);
+
+  sess.linesUntil(versionMark, (err, lines) => {
+    t.error(err);
+
+    const types = new Map();
+    for (const line of lines) {
+      const match = line.match(/^ +(\d+) +(\d+) (\S.*)$/);
+      if (match)
+        types.set(match[3], { count: +match[1], size: +match[2] });
+    }
+
+    sess.quit();
+    cb(types);
+  });
+}
+
+function test(executable, core, t) {
+  // Scan threads are only used when the core file is mapped
+  const env = { LLNODE_COREFILE: core, LLNODE_SCAN_THREADS: '1' };
+  findObjects(executable, core, env, t, (single) => {
+    t.ok(single.get('Class'), 'Class should be in findjsobjects');
+
+    env.LLNODE_SCAN_THREADS = '4';
+    findObjects(executable, core, env, t, (threaded) => {
+      t.deepEqual([ ...threaded.keys() ].sort(), [ ...single.keys() ].sort(),
+                  'A threaded scan should find the same types');
+      const different = [ ...single.keys() ].filter((type) => {
+        const expected = single.get(type);
+        const found = threaded.get(type);
+        return !found || found.count !== expected.count ||
+               found.size !== expected.size;
+      });
+      t.deepEqual(different, [],
+                  'A threaded scan should find as many objects of each type');
+      t.end();
+    });
+  });
+}